@@ -0,0 +1,24 @@
+#!/bin/bash
+# Wall-clock scaling of --engine conservative over threads against the serial engine;
+# speedup needs as many free cores as threads.
+# usage: bench/domains.sh [tumopp options...]
+# env: TUMOPP (executable), SIZE (value of -N), THREADS, OUTDIR
+set -eu
+TUMOPP=${TUMOPP:-tumopp}
+SIZE=${SIZE:-4000000}
+THREADS=${THREADS:-"1 2 4 8 16 32 64"}
+OUTDIR=${OUTDIR:-bench_domains}
+mkdir -p "$OUTDIR"
+wall() {
+  local start
+  start=$(date +%s%N)
+  "$TUMOPP" -N "$SIZE" -L step -P mindrag --benchmark "$@" >/dev/null
+  echo $(( ($(date +%s%N) - start) / 1000000 ))
+}
+printf "engine\tthreads\tms\tspeedup\n"
+serial=$(wall --engine serial -o "$OUTDIR/serial" "$@")
+printf "serial\t1\t%s\t1\n" "$serial"
+for threads in $THREADS; do
+  ms=$(wall --engine conservative -j "$threads" -o "$OUTDIR/conservative-$threads" "$@")
+  printf "conservative\t%s\t%s\t%s\n" "$threads" "$ms" "$(awk -v a="$serial" -v b="$ms" 'BEGIN{printf "%.2f", a / b}')"
+done
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Compare executables across local density effects (-L) and displacement paths (-P),
+# e.g., builds before and after a change of the grow loop.
+# usage: bench/grow.sh [tumopp options...]
+# env: TUMOPPS (executables), SIZE (value of -N), OUTDIR
+set -eu
+TUMOPPS=${TUMOPPS:-tumopp}
+SIZE=${SIZE:-1000000}
+OUTDIR=${OUTDIR:-bench_grow}
+mkdir -p "$OUTDIR"
+header=true
+for lp in const:random const:mindrag const:minstraight const:roulette const:stroll const:shortest \
+          step:random step:mindrag linear:random linear:mindrag; do
+  local_density=${lp%:*}
+  path=${lp#*:}
+  for tumopp in $TUMOPPS; do
+    out="$OUTDIR/$(basename "$tumopp")-$local_density-$path"
+    "$tumopp" -N "$SIZE" -L "$local_density" -P "$path" --benchmark -o "$out" "$@" >/dev/null
+    if $header; then
+      printf "L\tP\texe\t"; zcat "$out/benchmark.tsv.gz" | head -n1
+      header=false
+    fi
+    printf "%s\t%s\t%s\t" "$local_density" "$path" "$tumopp"; zcat "$out/benchmark.tsv.gz" | tail -n1
+  done
+done
@@ -0,0 +1,21 @@
+#!/bin/bash
+# Compare occupancy backends (--lattice) by resource usage at the final size.
+# usage: bench/lattice.sh [tumopp options...]
+# env: TUMOPP (executable), SIZES (values of -N), OUTDIR
+set -eu
+TUMOPP=${TUMOPP:-tumopp}
+SIZES=${SIZES:-"1000000 10000000 100000000"}
+OUTDIR=${OUTDIR:-bench_lattice}
+mkdir -p "$OUTDIR"
+header=true
+for size in $SIZES; do
+  for lattice in dense brick hash; do
+    out="$OUTDIR/$lattice-$size"
+    "$TUMOPP" -N "$size" --lattice "$lattice" --benchmark -o "$out" "$@" >/dev/null
+    if $header; then
+      printf "lattice\t"; zcat "$out/benchmark.tsv.gz" | head -n1
+      header=false
+    fi
+    printf "%s\t" "$lattice"; zcat "$out/benchmark.tsv.gz" | tail -n1
+  done
+done
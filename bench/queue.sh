@@ -0,0 +1,22 @@
+#!/bin/bash
+# Compare event queues (--queue) across gamma shapes of waiting times (-k).
+# usage: bench/queue.sh [tumopp options...]
+# env: TUMOPP (executable), SHAPES (values of -k), SIZE (value of -N), OUTDIR
+set -eu
+TUMOPP=${TUMOPP:-tumopp}
+SHAPES=${SHAPES:-"1 2 5 10 100"}
+SIZE=${SIZE:-1000000}
+OUTDIR=${OUTDIR:-bench_queue}
+mkdir -p "$OUTDIR"
+header=true
+for shape in $SHAPES; do
+  for queue in heap calendar multimap; do
+    out="$OUTDIR/$queue-$shape"
+    "$TUMOPP" -N "$SIZE" -k "$shape" --queue "$queue" --benchmark -o "$out" "$@" >/dev/null
+    if $header; then
+      printf "shape\tqueue\t"; zcat "$out/benchmark.tsv.gz" | head -n1
+      header=false
+    fi
+    printf "%s\t%s\t" "$shape" "$queue"; zcat "$out/benchmark.tsv.gz" | tail -n1
+  done
+done
@@ -9,14 +9,23 @@
   #include <wtl/resource.hpp>
 #endif // _WIN32
 
+#include <cstddef>
 #include <sstream>
+#include <vector>
 
 namespace tumopp {
 
-//! Utility class for benchmarking
+/*! @brief Utility class for benchmarking
+
+    Resource usage is recorded at each append().
+    Lengths of push chains, i.e., the numbers of cells displaced by a birth,
+    are counted in a histogram, which is also written and reset at each append(),
+    so that the cost of pushing can be tracked against the tumor size.
+*/
 class Benchmark {
   public:
     Benchmark() {
+        push_chains_sst_ << "size\tlength\tcount\n";
         sst_ << "size"
 #ifndef _WIN32
              << "\t" << wtl::rusage_header()
@@ -30,12 +39,28 @@ class Benchmark {
              << "\t" << wtl::getrusage<std::milli, std::kilo>()
 #endif // _WIN32
              << "\n";
+        for (std::size_t n = 0u; n < push_chains_.size(); ++n) {
+            if (push_chains_[n] == 0u) continue;
+            push_chains_sst_ << size << "\t" << n << "\t" << push_chains_[n] << "\n";
+        }
+        push_chains_.assign(push_chains_.size(), 0u);
+    }
+    //! Count a push chain that displaced n cells
+    void push_chain(std::size_t n) {
+        if (n >= push_chains_.size()) push_chains_.resize(n + 1u, 0u);
+        ++push_chains_[n];
     }
     //! Get TSV stream buffer
     std::streambuf* rdbuf() const {return sst_.rdbuf();}
+    //! Get TSV stream buffer of the histogram of push chains
+    std::streambuf* push_chains_rdbuf() const {return push_chains_sst_.rdbuf();}
   private:
     //! String in TSV format
     std::stringstream sst_{};
+    //! Histogram of push chains in TSV format
+    std::stringstream push_chains_sst_{};
+    //! Number of push chains by length since the last append()
+    std::vector<std::size_t> push_chains_{};
 };
 
 } // namespace tumopp
@@ -6,12 +6,10 @@
 #define TUMOPP_CELL_HPP_
 
 #include "coord.hpp"
-#include "random.hpp"
+#include "table.hpp"
 
 #include <cstdint>
-#include <unordered_set>
-#include <string>
-#include <memory>
+#include <iosfwd>
 
 namespace tumopp {
 
@@ -72,110 +70,50 @@ struct CellParams {
     double SD_MIG = 0.0;
 };
 
-/*! @brief Cancer cell
+/*! @brief Record of a cell in Genealogy
+
+    Extant cells are stored in CellStore column by column;
+    a Cell is made when a cell divides or dies, or when it is written.
 */
 class Cell {
   public:
-    //! Alias
-    using param_type = CellParams;
     //! Default constructor
     Cell() = default;
-    //! Constructor for first cells
-    Cell(const coord_t& v, unsigned i,
-         std::shared_ptr<EventRates> er=std::make_shared<EventRates>()) noexcept:
-      event_rates_(er), coord_(v), id_(i) {}
-    //! Copy constructor
-    Cell(const Cell& other) noexcept:
-      ancestor_(other.ancestor_),
-      event_rates_(other.event_rates_),
-      time_of_birth_(other.time_of_birth_),
-      coord_(other.coord_),
-      id_(other.id_),
-      proliferation_capacity_(other.proliferation_capacity_) {}
-    //! Destructor
-    ~Cell() noexcept = default;
-    //! Copy assignment operator
-    Cell& operator=(const Cell&) = delete;
-    //! Move constructor
-    Cell(Cell&& other) = default;
-    //! Move assignment operator
-    Cell& operator=(Cell&&) = default;
-
-    //! driver mutation
-    std::string mutate(urbg_t&);
-    //! driver mutation on all traits
-    std::string force_mutate(urbg_t&);
-
-    //! Calc dt and set #next_event_
-    double delta_time(urbg_t&, double now, double positional_value, bool surrounded=false);
-    //! Change #proliferation_capacity_ stochastically
-    void differentiate(urbg_t&);
-    //! Set #time_of_birth_; reset other properties
-    void set_time_of_birth(double t, unsigned i, const std::shared_ptr<Cell>& ancestor) noexcept {
-        time_of_birth_ = t;
-        id_ = i;
-        ancestor_ = ancestor;
-        if (is_differentiated()) {--proliferation_capacity_;}
-    }
-    //! Set #event_rates_->death_prob and #next_event_
-    void set_cycle_dependent_death(urbg_t&, double death_prob);
-    //! Increase #event_rates_->death_rate to birth_rate() for simulating Moran-like situation
-    void increase_death_rate() noexcept {event_rates_->death_rate = birth_rate();}
-    //! Check #proliferation_capacity_
-    bool is_differentiated() const noexcept {return proliferation_capacity_ >= 0;}
-
-    //! @name Setter functions
-    //@{
-    //! Add to #coord_
-    void add_coord(const coord_t& direction) noexcept {coord_ += direction;}
-    //! Set #coord_
-    void set_coord(const coord_t& v) noexcept {coord_ = v;}
-    //! Set #coord_
-    void set_coord(coord_t&& v) noexcept {coord_ = std::move(v);}
-    //! Set #time_of_death_
-    void set_time_of_death(double t) noexcept {time_of_death_ = t;}
-    //@}
+    //! Constructor for tests
+    Cell(const coord_t& v, unsigned i) noexcept:
+      coord_(v), id_(i) {}
+    //! Constructor
+    Cell(const coord_t& v, unsigned i, unsigned ancestor,
+         double time_of_birth, double time_of_death,
+         int8_t proliferation_capacity) noexcept:
+      time_of_birth_(time_of_birth),
+      time_of_death_(time_of_death),
+      coord_(v),
+      id_(i),
+      ancestor_(ancestor),
+      proliferation_capacity_(proliferation_capacity) {}
 
-    //! @name Getter functions
-    //@{
-    //! Get EventRates.birth_rate
-    double birth_rate() const noexcept {return event_rates_->birth_rate;}
-    //! Get EventRates.death_rate
-    double death_rate() const noexcept {return event_rates_->death_rate;}
-    //! Get EventRates.death_prob
-    double death_prob() const noexcept {return event_rates_->death_prob;}
-    //! Get EventRates.migration_rate
-    double migration_rate() const noexcept {return event_rates_->migration_rate;}
-    //! Get #next_event_
-    Event next_event() const noexcept {return next_event_;}
     //! Get #coord_
     const coord_t& coord() const noexcept {return coord_;}
-    //@}
+    //! Get #id_
+    unsigned id() const noexcept {return id_;}
 
     //! TSV header
     static const char* header();
     //! TSV
     std::ostream& write(std::ostream& ost) const;
-    //! Write TSV while tracing back #ancestor_ recursively
-    std::ostream& traceback(std::ostream& ost, std::unordered_set<unsigned>* done) const;
+    //! TSV
+    TsvWriter& write(TsvWriter& tsv) const;
+    //! Columns in TCF; the same as header()
+    static std::vector<Column> columns();
+    //! TCF
+    TableWriter& write(TableWriter& table) const;
     friend std::ostream& operator<< (std::ostream&, const Cell&);
 
-    //! Set #PARAM_
-    static void param(const param_type& p);
-    //! Get #PARAM_
-    static const param_type& param() {return PARAM_;}
-
   private:
-    //! Parameters shared among instances
-    static inline param_type PARAM_;
-
     /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
     // Data member
 
-    //! pointer to the ancestor
-    std::shared_ptr<Cell> ancestor_{nullptr};
-    //! Set of event rates (copy-on-write)
-    std::shared_ptr<EventRates> event_rates_{nullptr};
     //! time of birth
     double time_of_birth_{0.0};
     //! time of death
@@ -184,10 +122,10 @@ class Cell {
     coord_t coord_{};
     //! ID
     unsigned id_{};
+    //! ID of the ancestor; 0 if unknown
+    unsigned ancestor_{};
     //! \f$\omega\f$; stem cell if negative
     int8_t proliferation_capacity_{-1};
-    //! next event: birth, death, or migration
-    Event next_event_{Event::birth};
 };
 
 } // namespace tumopp
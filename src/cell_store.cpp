@@ -0,0 +1,288 @@
+/*! @file cell_store.cpp
+    @brief Implementation of CellStore class
+*/
+#include "cell_store.hpp"
+
+#include <wtl/iostr.hpp>
+#include <wtl/random.hpp>
+
+namespace tumopp {
+
+/////////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+namespace {
+
+template <class URBG>
+inline bool bernoulli(double p, URBG& engine) {
+    // consume less URBG when p is set to 0 or 1.
+    return p >= 1.0 || (p > 0.0 && wtl::generate_canonical(engine) < p);
+}
+
+}// namespace
+/////////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+
+void CellStore::param(const param_type& p) {
+    param_ = p;
+    using normal_param = std::normal_distribution<double>::param_type;
+    gauss_birth_.param(normal_param(param_.MEAN_BIRTH, param_.SD_BIRTH));
+    gauss_death_.param(normal_param(param_.MEAN_DEATH, param_.SD_DEATH));
+    gauss_alpha_.param(normal_param(param_.MEAN_ALPHA, param_.SD_ALPHA));
+    gauss_migration_.param(normal_param(param_.MEAN_MIG, param_.SD_MIG));
+}
+
+CellStore::CellStore():
+  coord_(1u), clone_(1u, 0u), ancestor_(1u, 0u), time_of_birth_(1u),
+  id_(1u, 0u), proliferation_capacity_(1u, -1), next_event_(1u, Event::birth) {
+    param(param_);
+}
+
+uint32_t CellStore::emplace(const coord_t& v, const unsigned id, const EventRates& er) {
+    clones_.push_back(er);
+    clone_sizes_.push_back(0u);
+    return allocate(v, id, static_cast<uint32_t>(clones_.size() - 1u));
+}
+
+uint32_t CellStore::clone(const uint32_t x) {
+    const uint32_t y = allocate(coord_[x], id_[x], clone_[x]);
+    ancestor_[y] = ancestor_[x];
+    time_of_birth_[y] = time_of_birth_[x];
+    proliferation_capacity_[y] = proliferation_capacity_[x];
+    return y;
+}
+
+void CellStore::release(const uint32_t x) {
+    --clone_sizes_[clone_[x]];
+    id_[x] = 0u;
+    vacant_.push_back(x);
+}
+
+void CellStore::reserve(const size_t n, std::vector<uint32_t>* handles) {
+    for (size_t i = 0u; i < n; ++i) {
+        if (vacant_.empty()) {
+            handles->push_back(static_cast<uint32_t>(id_.size()));
+            coord_.emplace_back();
+            clone_.push_back(0u);
+            ancestor_.push_back(0u);
+            time_of_birth_.push_back(0.0);
+            id_.push_back(0u);
+            proliferation_capacity_.push_back(-1);
+            next_event_.push_back(Event::birth);
+        } else {
+            handles->push_back(vacant_.back());
+            vacant_.pop_back();
+        }
+    }
+}
+
+void CellStore::unreserve(const uint32_t* first, const uint32_t* last) {
+    vacant_.insert(vacant_.end(), first, last);
+}
+
+uint32_t CellStore::reserve_clones(const size_t n) {
+    const auto first = static_cast<uint32_t>(clones_.size());
+    clones_.resize(clones_.size() + n);
+    clone_sizes_.resize(clones_.size(), 0u);
+    return first;
+}
+
+void CellStore::truncate_clones(const size_t n) {
+    clones_.resize(n);
+    clone_sizes_.resize(n);
+}
+
+void CellStore::clone_at(const uint32_t x, const uint32_t y, Shard* shard) {
+    coord_[y] = coord_[x];
+    clone_[y] = clone_[x];
+    ancestor_[y] = ancestor_[x];
+    time_of_birth_[y] = time_of_birth_[x];
+    id_[y] = id_[x];
+    proliferation_capacity_[y] = proliferation_capacity_[x];
+    next_event_[y] = Event::birth;
+    shard->sizes.emplace_back(clone_[x], 1);
+}
+
+void CellStore::count(Shard* shard) {
+    // negative changes wrap around and cancel out
+    for (const auto& p: shard->sizes) clone_sizes_[p.first] += static_cast<size_t>(p.second);
+    shard->sizes.clear();
+}
+
+uint32_t CellStore::allocate(const coord_t& v, const unsigned id, const uint32_t c) {
+    ++clone_sizes_[c];
+    uint32_t x = 0u;
+    if (vacant_.empty()) {
+        x = static_cast<uint32_t>(id_.size());
+        coord_.push_back(v);
+        clone_.push_back(c);
+        ancestor_.push_back(0u);
+        time_of_birth_.push_back(0.0);
+        id_.push_back(id);
+        proliferation_capacity_.push_back(-1);
+        next_event_.push_back(Event::birth);
+    } else {
+        x = vacant_.back();
+        vacant_.pop_back();
+        coord_[x] = v;
+        clone_[x] = c;
+        ancestor_[x] = 0u;
+        time_of_birth_[x] = 0.0;
+        id_[x] = id;
+        proliferation_capacity_[x] = -1;
+        next_event_[x] = Event::birth;
+    }
+    return x;
+}
+
+EventRates& CellStore::fork(const uint32_t x, Shard* shard) {
+    const EventRates er = clones_[clone_[x]];
+    if (shard) {
+        const uint32_t c = shard->next_clone;
+        shard->next_clone += shard->stride;
+        clones_[c] = er;
+        shard->sizes.emplace_back(clone_[x], -1);
+        shard->sizes.emplace_back(c, 1);
+        clone_[x] = c;
+        return clones_[c];
+    }
+    --clone_sizes_[clone_[x]];
+    clones_.push_back(er);
+    clone_sizes_.push_back(1u);
+    clone_[x] = static_cast<uint32_t>(clones_.size() - 1u);
+    return clones_.back();
+}
+
+void CellStore::differentiate(const uint32_t x, urbg_t& engine) {
+    if (is_differentiated(x)) return;
+    if (bernoulli(param_.PROB_SYMMETRIC_DIVISION, engine)) return;
+    proliferation_capacity_[x] = static_cast<int8_t>(param_.MAX_PROLIFERATION_CAPACITY);
+}
+
+std::string CellStore::mutate(const uint32_t x, urbg_t& engine, Shard* shard) {
+    auto oss = wtl::make_oss();
+    // distributions cache a variate; threads draw from copies
+    const auto gauss = [shard, &engine](std::normal_distribution<double>& dist) {
+        return shard ? std::normal_distribution<double>(dist.param())(engine) : dist(engine);
+    };
+    // new clone is appended on the first mutation
+    EventRates* mutant = nullptr;
+    if (bernoulli(param_.RATE_BIRTH, engine)) {
+        if (!mutant) mutant = &fork(x, shard);
+        double s = gauss(gauss_birth_);
+        oss << id_[x] << "\tbeta\t" << s << "\n";
+        mutant->birth_rate *= (s += 1.0);
+    }
+    if (bernoulli(param_.RATE_DEATH, engine)) {
+        if (!mutant) mutant = &fork(x, shard);
+        double s = gauss(gauss_death_);
+        oss << id_[x] << "\tdelta\t" << s << "\n";
+        mutant->death_rate *= (s += 1.0);
+    }
+    if (bernoulli(param_.RATE_ALPHA, engine)) {
+        if (!mutant) mutant = &fork(x, shard);
+        double s = gauss(gauss_alpha_);
+        oss << id_[x] << "\talpha\t" << s << "\n";
+        mutant->death_prob *= (s += 1.0);
+    }
+    if (bernoulli(param_.RATE_MIG, engine)) {
+        if (!mutant) mutant = &fork(x, shard);
+        double s = gauss(gauss_migration_);
+        oss << id_[x] << "\trho\t" << s << "\n";
+        mutant->migration_rate *= (s += 1.0);
+    }
+    return oss.str();
+}
+
+std::string CellStore::force_mutate(const uint32_t x, urbg_t& engine) {
+    EventRates& mutant = fork(x);
+    const double s_birth = gauss_birth_(engine);
+    const double s_death = gauss_death_(engine);
+    const double s_alpha = gauss_alpha_(engine);
+    const double s_migration = gauss_migration_(engine);
+    mutant.birth_rate *= (1.0 + s_birth);
+    mutant.death_rate *= (1.0 + s_death);
+    mutant.death_prob *= (1.0 + s_alpha);
+    mutant.migration_rate *= (1.0 + s_migration);
+    auto oss = wtl::make_oss();
+    if (s_birth != 0.0) {oss << id_[x] << "\tbeta\t"  << s_birth << "\n";}
+    if (s_death != 0.0) {oss << id_[x] << "\tdelta\t" << s_death << "\n";}
+    if (s_alpha != 0.0) {oss << id_[x] << "\talpha\t" << s_alpha << "\n";}
+    if (s_migration != 0.0) {oss << id_[x] << "\trho\t"   << s_migration << "\n";}
+    return oss.str();
+}
+
+double CellStore::delta_time(const uint32_t x, urbg_t& engine, const double now, const double positional_value, const bool surrounded) {
+    double t_birth = std::numeric_limits<double>::infinity();
+    double t_death = std::numeric_limits<double>::infinity();
+    double t_migration = std::numeric_limits<double>::infinity();
+    if (proliferation_capacity_[x] != 0) {
+        double mu = 1.0;
+        mu /= birth_rate(x);
+        mu /= positional_value;
+        if (!surrounded) mu -= (now - time_of_birth_[x]);
+        const double shape = param_.GAMMA_SHAPE;
+        t_birth = std::gamma_distribution<double>(shape, std::max(mu / shape, 0.0))(engine);
+    }
+    if (death_rate(x) > 0.0) {
+        std::exponential_distribution<double> exponential(death_rate(x));
+        t_death = exponential(engine);
+    }
+    if (migration_rate(x) > 0.0) {
+        std::exponential_distribution<double> exponential(migration_rate(x));
+        t_migration = exponential(engine);
+    }
+
+    if (t_birth < t_death && t_birth < t_migration) {
+        next_event_[x] = bernoulli(death_prob(x), engine)
+                         ? Event::death : Event::birth;
+        return t_birth;
+    } else if (t_death < t_migration) {
+        next_event_[x] = Event::death;
+        return t_death;
+    } else {
+        next_event_[x] = Event::migration;
+        return t_migration;
+    }
+}
+
+double CellStore::delta_time_dormant(const uint32_t x, urbg_t& engine) {
+    // Death on failed division attempts is replaced by
+    // an exponential distribution with the same rate,
+    // which is exact because GAMMA_SHAPE == 1; see parkable().
+    double rate_death = death_rate(x);
+    if (proliferation_capacity_[x] != 0) rate_death += death_prob(x) * birth_rate(x);
+    double t_death = std::numeric_limits<double>::infinity();
+    double t_migration = std::numeric_limits<double>::infinity();
+    if (rate_death > 0.0) {
+        std::exponential_distribution<double> exponential(rate_death);
+        t_death = exponential(engine);
+    }
+    if (migration_rate(x) > 0.0) {
+        std::exponential_distribution<double> exponential(migration_rate(x));
+        t_migration = exponential(engine);
+    }
+    if (t_death < t_migration) {
+        next_event_[x] = Event::death;
+        return t_death;
+    } else {
+        next_event_[x] = Event::migration;
+        return t_migration;
+    }
+}
+
+void CellStore::set_cycle_dependent_death(const std::vector<uint32_t>& cells, urbg_t& engine, const double p) {
+    // one treated clone per original clone
+    std::vector<uint32_t> treated(clones_.size(), UINT32_MAX);
+    for (const uint32_t x: cells) {
+        uint32_t& c = treated[clone_[x]];
+        if (c == UINT32_MAX) {
+            fork(x).death_prob = p;
+            c = clone_[x];
+        } else {
+            --clone_sizes_[clone_[x]];
+            ++clone_sizes_[c];
+            clone_[x] = c;
+        }
+        next_event_[x] = bernoulli(p, engine) ? Event::death : Event::birth;
+    }
+}
+
+} // namespace tumopp
@@ -0,0 +1,209 @@
+/*! @file cell_store.hpp
+    @brief Interface of CellStore class
+*/
+#pragma once
+#ifndef TUMOPP_CELL_STORE_HPP_
+#define TUMOPP_CELL_STORE_HPP_
+
+#include "cell.hpp"
+#include "random.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tumopp {
+
+/*! @brief Extant cells stored in columns and addressed by 32-bit handles
+
+    Handle 0 is reserved for Lattice::empty.
+    Slots of dead cells are recycled through a free list,
+    so that handles stay dense and can index other per-cell arrays.
+    A slot is vacant if its ID is 0.
+    Event rates are interned in a table of clones;
+    each cell holds a clone index, and a mutation appends a new clone.
+    Parameters and distributions of mutational effects belong to each instance,
+    so that independent tissues can grow concurrently.
+*/
+class CellStore {
+  public:
+    //! Alias
+    using param_type = CellParams;
+    //! Clone slots and changes of clone sizes of a thread; see reserve_clones()
+    struct Shard {
+        //! next reserved clone slot
+        uint32_t next_clone = 0u;
+        //! end of reserved clone slots
+        uint32_t end_clone = 0u;
+        //! step from a clone slot to the next
+        uint32_t stride = 1u;
+        //! pairs of clone index and change of its size; see count()
+        std::vector<std::pair<uint32_t, int>> sizes{};
+    };
+    //! Constructor: reserve handle 0 and set default parameters
+    CellStore();
+
+    //! Store a new cell of a new clone and return its handle
+    uint32_t emplace(const coord_t& v, unsigned id, const EventRates& er);
+    //! Store a copy of x and return its handle
+    uint32_t clone(uint32_t x);
+    //! Vacate the slot of x
+    void release(uint32_t x);
+
+    //! @name Concurrent changes
+    //! Threads may call clone_at() and mutate() on distinct cells
+    //! with handles and clone slots reserved in advance.
+    //@{
+    //! Append n vacant handles to handles, reusing the free list first
+    void reserve(size_t n, std::vector<uint32_t>* handles);
+    //! Put reserved handles that were not used back to the free list
+    void unreserve(const uint32_t* first, const uint32_t* last);
+    //! Append n placeholder clones and return the index of the first
+    uint32_t reserve_clones(size_t n);
+    //! Drop placeholder clones from index n to the end
+    void truncate_clones(size_t n);
+    //! Store a copy of x at a reserved handle y
+    void clone_at(uint32_t x, uint32_t y, Shard* shard);
+    //! Apply and clear Shard::sizes
+    void count(Shard* shard);
+    //@}
+    //! Check if mutate() may make a new clone
+    bool mutates() const noexcept {
+        return param_.RATE_BIRTH > 0.0 || param_.RATE_DEATH > 0.0
+            || param_.RATE_ALPHA > 0.0 || param_.RATE_MIG > 0.0;
+    }
+    //! Check if x is an extant cell
+    bool contains(uint32_t x) const noexcept {return id_[x] != 0u;}
+    //! Number of extant cells
+    size_t size() const noexcept {return id_.size() - vacant_.size() - 1u;}
+    //! Upper bound of handles
+    size_t slots() const noexcept {return id_.size();}
+
+    //! driver mutation; a new clone is taken from shard if given
+    std::string mutate(uint32_t x, urbg_t&, Shard* shard = nullptr);
+    //! driver mutation on all traits
+    std::string force_mutate(uint32_t x, urbg_t&);
+    //! Calc dt and set #next_event_
+    double delta_time(uint32_t x, urbg_t&, double now, double positional_value, bool surrounded=false);
+    //! Calc dt and set #next_event_ while birth is suspended; only if parkable()
+    double delta_time_dormant(uint32_t x, urbg_t&);
+    //! Check if surrounded cells can suspend birth without changing the dynamics;
+    //! otherwise they keep drawing birth attempts, and one that succeeds
+    //! after a neighbor is vacated comes sooner than a fresh draw
+    bool parkable() const noexcept {return param_.GAMMA_SHAPE == 1.0;}
+    //! Change #proliferation_capacity_ stochastically
+    void differentiate(uint32_t x, urbg_t&);
+    //! Set #time_of_birth_; reset other properties
+    void set_time_of_birth(uint32_t x, double t, unsigned i, uint32_t ancestor) noexcept {
+        time_of_birth_[x] = t;
+        id_[x] = i;
+        ancestor_[x] = ancestor;
+        if (is_differentiated(x)) {--proliferation_capacity_[x];}
+    }
+    //! Set EventRates.death_prob and #next_event_ of cells
+    void set_cycle_dependent_death(const std::vector<uint32_t>& cells, urbg_t&, double death_prob);
+    //! Increase EventRates.death_rate to birth_rate for simulating Moran-like situation
+    void increase_death_rate() noexcept {
+        for (auto& er: clones_) er.death_rate = er.birth_rate;
+    }
+    //! Check #proliferation_capacity_
+    bool is_differentiated(uint32_t x) const noexcept {return proliferation_capacity_[x] >= 0;}
+
+    //! @name Setter functions
+    //@{
+    //! Add to #coord_
+    void add_coord(uint32_t x, const coord_t& direction) noexcept {coord_[x] += direction;}
+    //! Set #coord_
+    void set_coord(uint32_t x, const coord_t& v) noexcept {coord_[x] = v;}
+    //! Set #ancestor_
+    void set_ancestor(uint32_t x, uint32_t ancestor) noexcept {ancestor_[x] = ancestor;}
+    //@}
+
+    //! @name Getter functions
+    //@{
+    //! Get EventRates.birth_rate
+    double birth_rate(uint32_t x) const noexcept {return clones_[clone_[x]].birth_rate;}
+    //! Get EventRates.death_rate
+    double death_rate(uint32_t x) const noexcept {return clones_[clone_[x]].death_rate;}
+    //! Get EventRates.death_prob
+    double death_prob(uint32_t x) const noexcept {return clones_[clone_[x]].death_prob;}
+    //! Get EventRates.migration_rate
+    double migration_rate(uint32_t x) const noexcept {return clones_[clone_[x]].migration_rate;}
+    //! Get #clone_
+    uint32_t clone_index(uint32_t x) const noexcept {return clone_[x];}
+    //! Number of extant cells in clone c
+    size_t clone_size(uint32_t c) const noexcept {return clone_sizes_[c];}
+    //! Number of clones including extinct ones
+    size_t num_clones() const noexcept {return clones_.size();}
+    //! Get #next_event_
+    Event next_event(uint32_t x) const noexcept {return next_event_[x];}
+    //! Get #coord_
+    const coord_t& coord(uint32_t x) const noexcept {return coord_[x];}
+    //! Get #id_
+    unsigned id(uint32_t x) const noexcept {return id_[x];}
+    //! Get #ancestor_
+    uint32_t ancestor(uint32_t x) const noexcept {return ancestor_[x];}
+    //! Get #time_of_birth_
+    double time_of_birth(uint32_t x) const noexcept {return time_of_birth_[x];}
+    //! Get #proliferation_capacity_
+    int8_t proliferation_capacity(uint32_t x) const noexcept {return proliferation_capacity_[x];}
+    //@}
+
+    //! Bytes per cell in the columns
+    static constexpr size_t bytes_per_cell =
+        sizeof(coord_t) + sizeof(uint32_t)
+        + sizeof(uint32_t) + sizeof(double) + sizeof(unsigned)
+        + sizeof(int8_t) + sizeof(Event);
+
+    //! Set #param_
+    void param(const param_type& p);
+    //! Get #param_
+    const param_type& param() const noexcept {return param_;}
+
+  private:
+    //! Store a new cell of clone c and return its handle
+    uint32_t allocate(const coord_t& v, unsigned id, uint32_t c);
+    //! Move x to a new copy of its clone and return the new event rates
+    EventRates& fork(uint32_t x, Shard* shard = nullptr);
+
+    /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+    // Data member
+
+    //! Parameters
+    param_type param_{};
+    //! \f$s_\beta\f$ of driver mutations
+    std::normal_distribution<double> gauss_birth_{};
+    //! \f$s_\delta\f$ of driver mutations
+    std::normal_distribution<double> gauss_death_{};
+    //! \f$s_\alpha\f$ of driver mutations
+    std::normal_distribution<double> gauss_alpha_{};
+    //! \f$s_\rho\f$ of driver mutations
+    std::normal_distribution<double> gauss_migration_{};
+
+    //! Position in a tumor
+    std::vector<coord_t> coord_;
+    //! index of the clone in #clones_
+    std::vector<uint32_t> clone_;
+    //! index of the ancestor in Genealogy; 0 if unknown
+    std::vector<uint32_t> ancestor_;
+    //! time of birth
+    std::vector<double> time_of_birth_;
+    //! ID; 0 if vacant
+    std::vector<unsigned> id_;
+    //! \f$\omega\f$; stem cell if negative
+    std::vector<int8_t> proliferation_capacity_;
+    //! next event: birth, death, or migration
+    std::vector<Event> next_event_;
+    //! vacant handles
+    std::vector<uint32_t> vacant_{};
+    //! event rates of each clone
+    std::vector<EventRates> clones_{};
+    //! number of extant cells in each clone
+    std::vector<size_t> clone_sizes_{};
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_CELL_STORE_HPP_
@@ -43,75 +43,22 @@ double _euclidean_distance(const std::array<T, MAX_DIM>& v) {
 
 }// namespace
 
-Coord::Coord(unsigned d): dimensions_(d) {
+Coord::Coord(unsigned d, std::vector<coord_t>&& directions):
+  dimensions_(d), directions_(std::move(directions)) {
     if (d < 1u || MAX_DIM < d) {
         throw std::runtime_error("Invalid value for dimensions");
     }
-    if (dimensions_ == 1u) {
-        directions_.push_back({1, 0, 0});
-        directions_.push_back({-1, 0, 0});
-        dist_direction_.param(decltype(dist_direction_)::param_type(0, 1u));
-    }
-}
-
-Neumann::Neumann(const unsigned d): Coord(d) {
-    if (dimensions_ < 2u) return;
-    directions_.reserve(2U * dimensions_);
-    for (unsigned i = 0; i < dimensions_; ++i) {
-        coord_t v{};
-        v[i] = 1;
-        directions_.push_back(v);
-        v[i] = -1;
-        directions_.push_back(v);
-    }
     auto max = static_cast<unsigned>(directions_.size()) - 1;
     dist_direction_.param(decltype(dist_direction_)::param_type(0, max));
 }
 
-Moore::Moore(const unsigned d): Coord(d) {
-    if (dimensions_ < 2u) return;
-    directions_.reserve(ipow(3u, dimensions_) - 1u);
-    for (const int x: {-1, 0, 1}) {
-        for (const int y: {-1, 0, 1}) {
-            if (dimensions_ == 2U) {
-                if (x == 0 && y == 0) continue;
-                directions_.push_back({{x, y, 0}});
-                continue;
-            }
-            for (const int z: {-1, 0, 1}) {
-                if (x == 0 && y == 0 && z == 0) continue;
-                directions_.push_back({{x, y, z}});
-            }
-        }
-    }
-    auto max = static_cast<unsigned>(directions_.size()) - 1;
-    dist_direction_.param(decltype(dist_direction_)::param_type(0, max));
-}
-
-Hexagonal::Hexagonal(const unsigned d): Coord(d) {
-    if (dimensions_ < 2u) return;
-    coord_t v{{-1, 0, 1}};
-    directions_.reserve(6 * (dimensions_ - 1));
-    do {
-        directions_.push_back({{v[0], v[1], 0}});
-    } while (std::next_permutation(std::begin(v), std::end(v)));
-    if (dimensions_ > 2u) {
-        directions_.push_back({{0, 0, -1}});
-        directions_.push_back({{1, 0, -1}});
-        directions_.push_back({{1, -1, -1}});
-        directions_.push_back({{0, 0, 1}});
-        directions_.push_back({{-1, 0, 1}});
-        directions_.push_back({{-1, 1, 1}});
-    }
-    auto max = static_cast<unsigned>(directions_.size()) - 1;
-    dist_direction_.param(decltype(dist_direction_)::param_type(0, max));
-}
-
-int Neumann::graph_distance(const coord_t& v) const {
+template <unsigned D>
+int Neumann<D>::graph_distance(const coord_t& v) const {
     return sum(abs(v));
 }
 
-int Moore::graph_distance(const coord_t& v) const {
+template <unsigned D>
+int Moore<D>::graph_distance(const coord_t& v) const {
     return max(abs(v));
 }
 
@@ -121,13 +68,14 @@ std::array<double, MAX_DIM> Coord::continuous(const coord_t& v) const {
     return out;
 }
 
-std::array<double, MAX_DIM> Hexagonal::continuous(const coord_t& v) const {
+template <unsigned D>
+std::array<double, MAX_DIM> Hexagonal<D>::continuous(const coord_t& v) const {
     std::array<double, MAX_DIM> true_pos{};
     true_pos[0] += static_cast<double>(v[0]);
     true_pos[1] += static_cast<double>(v[1]);
     true_pos[1] += true_pos[0] * 0.5;
     true_pos[0] *= std::sqrt(3.0 / 4.0);
-    if (dimensions_ > 2U) {
+    if (D > 2U) {
         true_pos[2] += static_cast<double>(v[2]);
         true_pos[0] += true_pos[2] / std::sqrt(3.0);
         true_pos[2] *= std::sqrt(2.0 / 3.0);
@@ -135,9 +83,10 @@ std::array<double, MAX_DIM> Hexagonal::continuous(const coord_t& v) const {
     return true_pos;
 }
 
-int Hexagonal::graph_distance(const coord_t& v) const {
+template <unsigned D>
+int Hexagonal<D>::graph_distance(const coord_t& v) const {
     int d = std::max(max(abs(v)), std::abs(v[0] + v[1]));
-    if (dimensions_ > 2U) {
+    if (D > 2U) {
         return std::max(d, std::abs(v[0] + v[2]));
     }
     return d;
@@ -147,7 +96,8 @@ double Coord::euclidean_distance(const coord_t& v) const {
     return _euclidean_distance(v);
 }
 
-double Hexagonal::euclidean_distance(const coord_t& v) const {
+template <unsigned D>
+double Hexagonal<D>::euclidean_distance(const coord_t& v) const {
     return _euclidean_distance(continuous(v));
 }
 
@@ -166,9 +116,10 @@ std::vector<coord_t> Coord::core() const {
     return output;
 }
 
-std::vector<coord_t> Hexagonal::core() const {
-    std::vector<coord_t> output = Neumann(dimensions_).core();
-    if (dimensions_ == 3U) {
+template <unsigned D>
+std::vector<coord_t> Hexagonal<D>::core() const {
+    std::vector<coord_t> output = Coord::core();
+    if (D == 3U) {
         output.resize(3);
         output.push_back({{1, 0, -1}});
     }
@@ -212,4 +163,14 @@ std::vector<coord_t> Coord::sphere(const size_t n) const {
     return output;
 }
 
+template class Neumann<1u>;
+template class Neumann<2u>;
+template class Neumann<3u>;
+template class Moore<1u>;
+template class Moore<2u>;
+template class Moore<3u>;
+template class Hexagonal<1u>;
+template class Hexagonal<2u>;
+template class Hexagonal<3u>;
+
 } // namespace tumopp
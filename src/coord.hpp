@@ -6,6 +6,7 @@
 #define TUMOPP_COORD_HPP_
 
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <random>
 
@@ -18,16 +19,92 @@ constexpr unsigned MAX_DIM = 3u;
 //! Alias of coordinate type
 using coord_t = std::array<int, MAX_DIM>;
 
-//! hash coordinates for std::unordered_* container
-inline size_t hash(const coord_t& v) {
-    // no collision as long as each of v is within +-1e6
-    constexpr coord_t::value_type mask21 = 0x001fffff;
-    size_t seed = v[0u] & mask21;
-    seed |= static_cast<size_t>(v[1u] & mask21) << 21;
-    seed |= static_cast<size_t>(v[2u] & mask21) << 42;
-    return seed;
+//! Alias of packed coordinates
+using packed_t = uint64_t;
+
+/*! @name Packed coordinates
+
+    Each of the d axes is stored in a field of packed_bits(d) bits,
+    biased by packed_limit(d) to be non-negative,
+    so that a neighbor is reached by adding pack_direction()
+    as long as no field crosses 0 or packed_mask(d).
+    The field width adapts to the number of dimensions:
+    32 bits cover the whole range of coord_t in 1D and 2D,
+    whereas 21 bits limit 3D coordinates to about +-1e6.
+    Different coordinates within the range never share a key.
+*/
+//@{
+//! Bits per axis in packed_t
+constexpr unsigned packed_bits(const unsigned d) noexcept {
+    return d < MAX_DIM ? 32u : 64u / MAX_DIM;
 }
 
+//! Bias of each field; coordinates must be within +-packed_limit(d)
+constexpr int64_t packed_limit(const unsigned d) noexcept {
+    return int64_t{1} << (packed_bits(d) - 1u);
+}
+
+//! Mask of a field
+constexpr packed_t packed_mask(const unsigned d) noexcept {
+    return (packed_t{1u} << packed_bits(d)) - 1u;
+}
+
+//! Extract the field of axis j
+constexpr packed_t packed_field(const packed_t key, const unsigned j, const unsigned d) noexcept {
+    return (key >> (packed_bits(d) * j)) & packed_mask(d);
+}
+
+//! Pack the first d axes of v
+constexpr packed_t pack(const coord_t& v, const unsigned d) noexcept {
+    packed_t key = 0u;
+    for (unsigned j = 0u; j < d; ++j) {
+        const auto field = static_cast<packed_t>(v[j] + packed_limit(d));
+        key |= field << (packed_bits(d) * j);
+    }
+    return key;
+}
+
+//! Inverse of pack()
+constexpr coord_t unpack(const packed_t key, const unsigned d) noexcept {
+    coord_t v{};
+    for (unsigned j = 0u; j < d; ++j) {
+        v[j] = static_cast<int>(static_cast<int64_t>(packed_field(key, j, d)) - packed_limit(d));
+    }
+    return v;
+}
+
+//! Difference of packed coordinates; adding it to a key moves by direction
+constexpr packed_t pack_direction(const coord_t& direction, const unsigned d) noexcept {
+    return pack(direction, d) - pack(coord_t{}, d);
+}
+
+//! Check if neighbors of v can be reached by pack_direction() without overflow
+constexpr bool is_packable(const coord_t& v, const unsigned d) noexcept {
+    for (unsigned j = 0u; j < d; ++j) {
+        if (v[j] <= -packed_limit(d) || packed_limit(d) - 1 <= v[j]) return false;
+    }
+    return true;
+}
+
+//! Check if neighbors of a key can be reached by pack_direction() without overflow
+constexpr bool is_packable(const packed_t key, const unsigned d) noexcept {
+    for (unsigned j = 0u; j < d; ++j) {
+        const packed_t field = packed_field(key, j, d);
+        if (field == 0u || field == packed_mask(d)) return false;
+    }
+    return true;
+}
+
+//! pack() in the dimensions of the coordinate system C
+template <class C> constexpr
+packed_t pack(const coord_t& v) noexcept {return pack(v, C::num_dimensions);}
+
+//! pack_direction() in the dimensions of the coordinate system C
+template <class C> constexpr
+packed_t pack_direction(const coord_t& direction) noexcept {
+    return pack_direction(direction, C::num_dimensions);
+}
+//@}
 
 //! @cond
 //! @name Arithmetic operators for std::array
@@ -84,6 +161,11 @@ std::array<T, MAX_DIM> operator*(const std::array<T, MAX_DIM>& lhs, T rhs) {
 //! @endcond
 
 /*! @brief Base class of coordinate system
+
+    Derived classes are templated on the number of dimensions,
+    and their directions are known at compile time as `table`.
+    Hot loops can be instantiated for each of them to avoid virtual calls;
+    the runtime interface is kept for the rest.
 */
 class Coord {
   public:
@@ -116,26 +198,105 @@ class Coord {
     //! Default constructor is deleted
     Coord() = delete;
     //! Constructor: initialize and check #dimensions_
-    explicit Coord(unsigned d);
+    Coord(unsigned d, std::vector<coord_t>&& directions);
 
     /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
     // Data member
 
     //! {1, 2, 3}
     const unsigned dimensions_{};
-    //! initialized in derived class constructor
+    //! copy of the table of derived class
     std::vector<coord_t> directions_{};
-    //! initialized in derived class constructor
+    //! uniform over indices of #directions_
     std::uniform_int_distribution<unsigned> dist_direction_{};
 };
 
+//! Choose a random neighbor without virtual calls; same as Coord::random_direction()
+template <class C, class URBG> inline
+const coord_t& random_direction(URBG& engine) {
+    std::uniform_int_distribution<unsigned> uniform(0u, static_cast<unsigned>(C::table.size()) - 1u);
+    return C::table[uniform(engine)];
+}
+
+//! @cond
+//! @name Compile-time tables of directions
+//@{
+//! +x, -x, +y, -y, +z, -z
+template <unsigned D> constexpr
+std::array<coord_t, 2u * D> neumann_directions() {
+    std::array<coord_t, 2u * D> table{};
+    for (unsigned i = 0u; i < D; ++i) {
+        table[2u * i][i] = 1;
+        table[2u * i + 1u][i] = -1;
+    }
+    return table;
+}
+
+//! Lexicographic order from (-1, -1, -1), except for 1D
+template <unsigned D> constexpr
+std::array<coord_t, (D == 3u ? 27u : D == 2u ? 9u : 3u) - 1u> moore_directions() {
+    if constexpr (D == 1u) return neumann_directions<1u>();
+    std::array<coord_t, (D == 3u ? 27u : D == 2u ? 9u : 3u) - 1u> table{};
+    const int z_lim = (D == 3u) ? 1 : 0;
+    size_t i = 0u;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int z = -z_lim; z <= z_lim; ++z) {
+                if (x == 0 && y == 0 && z == 0) continue;
+                table[i][0] = x;
+                table[i][1] = y;
+                table[i][2] = z;
+                ++i;
+            }
+        }
+    }
+    return table;
+}
+
+//! Permutations of (-1, 0, 1) in 2D, and six more in 3D
+template <unsigned D> constexpr
+std::array<coord_t, D == 1u ? 2u : 6u * (D - 1u)> hexagonal_directions() {
+    if constexpr (D == 1u) return neumann_directions<1u>();
+    std::array<coord_t, D == 1u ? 2u : 6u * (D - 1u)> table{};
+    constexpr int plane[6][2] = {{-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}};
+    constexpr int layers[6][3] = {{0, 0, -1}, {1, 0, -1}, {1, -1, -1},
+                                  {0, 0, 1}, {-1, 0, 1}, {-1, 1, 1}};
+    for (size_t i = 0u; i < 6u; ++i) {
+        table[i][0] = plane[i][0];
+        table[i][1] = plane[i][1];
+    }
+    for (size_t i = 6u; i < table.size(); ++i) {
+        for (size_t j = 0u; j < 3u; ++j) {
+            table[i][j] = layers[i - 6u][j];
+        }
+    }
+    return table;
+}
+//! Apply pack_direction() to a table
+template <size_t N> constexpr
+std::array<packed_t, N> pack_directions(const std::array<coord_t, N>& table, unsigned d) {
+    std::array<packed_t, N> steps{};
+    for (size_t i = 0u; i < N; ++i) {
+        steps[i] = pack_direction(table[i], d);
+    }
+    return steps;
+}
+//@}
+//! @endcond
+
 /*! @brief Derived class of Coord
 */
+template <unsigned D>
 class Neumann final: public Coord {
   public:
-    Neumann() = delete;
+    //! Directions known at compile time
+    static constexpr auto table = neumann_directions<D>();
+    //! pack_direction() of #table
+    static constexpr auto packed_table = pack_directions(table, D);
+    //! Number of dimensions known at compile time
+    static constexpr unsigned num_dimensions = D;
     //! Constructor
-    explicit Neumann(const unsigned d);
+    Neumann(): Coord(D, {table.begin(), table.end()}) {}
     ~Neumann() = default;
     //! Manhattan distance
     int graph_distance(const coord_t& v) const override;
@@ -145,11 +306,17 @@ class Neumann final: public Coord {
 
     Neumann + diagonal cells
 */
+template <unsigned D>
 class Moore final: public Coord {
   public:
-    Moore() = delete;
+    //! Directions known at compile time
+    static constexpr auto table = moore_directions<D>();
+    //! pack_direction() of #table
+    static constexpr auto packed_table = pack_directions(table, D);
+    //! Number of dimensions known at compile time
+    static constexpr unsigned num_dimensions = D;
     //! Constructor
-    explicit Moore(const unsigned d);
+    Moore(): Coord(D, {table.begin(), table.end()}) {}
     ~Moore() = default;
     //! Chebyshev/chessboard distance
     int graph_distance(const coord_t& v) const override;
@@ -157,11 +324,17 @@ class Moore final: public Coord {
 
 /*! @brief Derived class of Coord
 */
+template <unsigned D>
 class Hexagonal final: public Coord {
   public:
-    Hexagonal() = delete;
+    //! Directions known at compile time
+    static constexpr auto table = hexagonal_directions<D>();
+    //! pack_direction() of #table
+    static constexpr auto packed_table = pack_directions(table, D);
+    //! Number of dimensions known at compile time
+    static constexpr unsigned num_dimensions = D;
     //! Constructor
-    explicit Hexagonal(const unsigned d);
+    Hexagonal(): Coord(D, {table.begin(), table.end()}) {}
     ~Hexagonal() = default;
     std::array<double, MAX_DIM> continuous(const coord_t& v) const override;
     int graph_distance(const coord_t& v) const override;
@@ -169,6 +342,19 @@ class Hexagonal final: public Coord {
     std::vector<coord_t> core() const override;
 };
 
+//! @cond
+// instantiated in coord.cpp
+extern template class Neumann<1u>;
+extern template class Neumann<2u>;
+extern template class Neumann<3u>;
+extern template class Moore<1u>;
+extern template class Moore<2u>;
+extern template class Moore<3u>;
+extern template class Hexagonal<1u>;
+extern template class Hexagonal<2u>;
+extern template class Hexagonal<3u>;
+//! @endcond
+
 } // namespace tumopp
 
 #endif // TUMOPP_COORD_HPP_
@@ -0,0 +1,189 @@
+/*! @file domain.hpp
+    @brief Defines Domain and Fence classes
+*/
+#pragma once
+#ifndef TUMOPP_DOMAIN_HPP_
+#define TUMOPP_DOMAIN_HPP_
+
+#include "coord.hpp"
+#include "cell_store.hpp"
+#include "random.hpp"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace tumopp {
+
+/*! @brief Earliest deferred events around tiles of the lattice in a window
+
+    Events deferred to the serial part of a window of Tissue::grow_domains()
+    are recorded in the tile of the cell and the adjacent tiles,
+    so that a box can tell in O(1) whether an event of its cell
+    would pass a deferred event within #width sites.
+    Times earlier than the start of the window are stale,
+    so that nothing is cleared between windows.
+    Each instance is written by a single thread.
+*/
+class Fence {
+  public:
+    //! Width of tiles: two events that touch a common site are within 2 * reach,
+    //! and a cell created or woken by an event is within 1 step
+    static constexpr int width(int reach) noexcept {return 2 * reach + 1;}
+
+    //! Cover the bounding box [lower, lower + extent) with tiles of w sites
+    void cover(const coord_t& lower, const std::array<unsigned, MAX_DIM>& extent, int w) {
+        if (lower == lower_ && extent == extent_ && w == width_) return;
+        lower_ = lower;
+        extent_ = extent;
+        width_ = w;
+        size_t n = 1u;
+        for (unsigned j = 0u; j < MAX_DIM; ++j) {
+            tiles_[j] = (extent[j] + static_cast<unsigned>(w) - 1u) / static_cast<unsigned>(w);
+            n *= tiles_[j];
+        }
+        times_.assign(n, -1.0);
+    }
+    //! Start a window at t
+    void start(double t) noexcept {start_ = t;}
+    //! Record an event at v at time t
+    void insert(const coord_t& v, double t) noexcept {
+        std::array<unsigned, MAX_DIM> first{};
+        std::array<unsigned, MAX_DIM> last{};
+        for (unsigned j = 0u; j < MAX_DIM; ++j) {
+            const unsigned i = tile(v, j);
+            first[j] = (i > 0u) ? i - 1u : 0u;
+            last[j] = std::min(i + 1u, tiles_[j] - 1u);
+        }
+        for (unsigned z = first[2]; z <= last[2]; ++z) {
+            for (unsigned y = first[1]; y <= last[1]; ++y) {
+                for (unsigned x = first[0]; x <= last[0]; ++x) {
+                    auto& time = times_[(size_t{z} * tiles_[1] + y) * tiles_[0] + x];
+                    if (time < start_ || t < time) time = t;
+                }
+            }
+        }
+    }
+    //! Earliest event recorded within #width sites of v; infinity if none
+    double at(const coord_t& v) const noexcept {
+        const double t = times_[(size_t{tile(v, 2u)} * tiles_[1] + tile(v, 1u)) * tiles_[0] + tile(v, 0u)];
+        return (t < start_) ? std::numeric_limits<double>::infinity() : t;
+    }
+
+  private:
+    //! Index of the tile of v along axis j; clamped to the bounding box
+    unsigned tile(const coord_t& v, unsigned j) const noexcept {
+        if (v[j] < lower_[j]) return 0u;
+        return std::min(static_cast<unsigned>(v[j] - lower_[j]) / static_cast<unsigned>(width_),
+                        tiles_[j] - 1u);
+    }
+
+    //! lower corner of the bounding box
+    coord_t lower_{};
+    //! width of the bounding box
+    std::array<unsigned, MAX_DIM> extent_{};
+    //! number of tiles along each axis
+    std::array<unsigned, MAX_DIM> tiles_{};
+    //! width of tiles
+    int width_{0};
+    //! start of the current window
+    double start_{0.0};
+    //! earliest event around each tile; stale if earlier than #start_
+    std::vector<double> times_{};
+};
+
+/*! @brief Box of a tissue grown by a thread in Tissue::grow_domains()
+
+    Events of cells in the interior of a box,
+    which is #margin sites away from the neighboring boxes,
+    are processed in parallel with the other boxes;
+    they only read and write sites within Tissue::domain_reach of the cell,
+    so that no two boxes touch the same site or cell.
+    Events of the other cells, and those that would pass an earlier event
+    in #outbox nearby, are moved to #outbox and processed serially.
+    Cells deferred by a box are within a step of its interior,
+    so that their events do not touch sites of the other boxes,
+    which therefore need not check #fence.
+    Handles, records, IDs, and clones are taken from ranges fixed for
+    each box at the start of a window, so that the results do not depend
+    on the timing of threads.
+*/
+struct Domain {
+    //! Pair of time and cell handle
+    using event_type = std::pair<double, uint32_t>;
+    //! Distance between the interior and the boundary of a box
+    static constexpr int margin = 3;
+
+    //! Schedule x at time t
+    void push(double t, uint32_t x) {
+        heap.emplace_back(t, x);
+        std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+    }
+    //! Remove and return the earliest event
+    event_type pop() {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+        const event_type event = heap.back();
+        heap.pop_back();
+        return event;
+    }
+    //! Check if v is in the interior
+    bool contains(const coord_t& v) const noexcept {
+        for (unsigned j = 0u; j < MAX_DIM; ++j) {
+            if (v[j] < lower[j] || upper[j] <= v[j]) return false;
+        }
+        return true;
+    }
+
+    //! random number generator; reseeded at every window
+    urbg_t engine{0u};
+    //! time of the current event
+    double time = 0.0;
+    //! lower bounds of the interior
+    coord_t lower{INT_MIN, INT_MIN, INT_MIN};
+    //! upper bounds of the interior
+    coord_t upper{INT_MAX, INT_MAX, INT_MAX};
+    //! min-heap of events; stale if the time differs from Tissue::schedule_
+    std::vector<event_type> heap{};
+    //! events to be processed serially after the window
+    std::vector<event_type> outbox{};
+    //! earliest events in #outbox
+    Fence fence{};
+    //! [#handle, #handle_end) of Tissue::reserved_
+    size_t handle = 0u;
+    //! end of reserved handles
+    size_t handle_end = 0u;
+    //! next reserved record in Genealogy; boxes take every Tissue::num_domains_-th
+    size_t record = 0u;
+    //! end of reserved records
+    size_t record_end = 0u;
+    //! next ID; boxes take every Tissue::num_domains_-th
+    size_t id = 0u;
+    //! reserved clones and changes of clone sizes
+    CellStore::Shard shard{};
+    //! dead cells to be released after the window
+    std::vector<uint32_t> dead{};
+    //! driver mutations
+    std::ostringstream drivers{};
+    //! order of directions shuffled for -L step
+    std::vector<unsigned> adjacent_order{};
+    //! change in the number of dormant cells
+    long dormant = 0;
+    //! number of events processed
+    size_t events = 0u;
+    //! exception thrown in a thread
+    std::exception_ptr error = nullptr;
+    //! whether this processes every cell with the shared resources of Tissue
+    bool serial = false;
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_DOMAIN_HPP_
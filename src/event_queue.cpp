@@ -0,0 +1,249 @@
+/*! @file event_queue.cpp
+    @brief Implementation of EventQueue class
+*/
+#include "event_queue.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace tumopp {
+
+std::vector<uint32_t> MultimapQueue::handles() const {
+    std::vector<uint32_t> output;
+    output.reserve(map_.size());
+    for (const auto& p: map_) {
+        output.push_back(p.second);
+    }
+    return output;
+}
+
+std::vector<uint32_t> HeapQueue::handles() const {
+    auto entries = heap_;
+    std::sort(entries.begin(), entries.end(), before);
+    std::vector<uint32_t> output;
+    output.reserve(entries.size());
+    for (const auto& entry: entries) {
+        output.push_back(entry.handle);
+    }
+    return output;
+}
+
+void HeapQueue::sift_up(size_t i) {
+    const Entry entry = heap_[i];
+    while (i > 0u) {
+        const size_t parent = (i - 1u) / arity;
+        if (!before(entry, heap_[parent])) break;
+        heap_[i] = heap_[parent];
+        pos_[heap_[i].handle] = static_cast<uint32_t>(i);
+        i = parent;
+    }
+    heap_[i] = entry;
+    pos_[entry.handle] = static_cast<uint32_t>(i);
+}
+
+void HeapQueue::sift_down(size_t i) {
+    const Entry entry = heap_[i];
+    const size_t n = heap_.size();
+    while (true) {
+        const size_t first = i * arity + 1u;
+        if (first >= n) break;
+        const size_t last = std::min(first + arity, n);
+        size_t child = first;
+        for (size_t c = first + 1u; c < last; ++c) {
+            if (before(heap_[c], heap_[child])) child = c;
+        }
+        if (!before(heap_[child], entry)) break;
+        heap_[i] = heap_[child];
+        pos_[heap_[i].handle] = static_cast<uint32_t>(i);
+        i = child;
+    }
+    heap_[i] = entry;
+    pos_[entry.handle] = static_cast<uint32_t>(i);
+}
+
+void HeapQueue::remove(const size_t i) {
+    pos_[heap_[i].handle] = npos;
+    const Entry last = heap_.back();
+    heap_.pop_back();
+    if (i == heap_.size()) return;
+    const Entry old = heap_[i];
+    heap_[i] = last;
+    if (before(last, old)) {
+        sift_up(i);
+    } else {
+        sift_down(i);
+    }
+}
+
+void HeapQueue::renumber() {
+    // the order of entries and thus the heap property are kept
+    std::vector<uint32_t> order(heap_.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+        return heap_[lhs].sequence < heap_[rhs].sequence;
+    });
+    sequence_ = 0u;
+    for (const auto i: order) heap_[i].sequence = sequence_++;
+}
+
+void CalendarQueue::push(const double t, const uint32_t x) {
+    if (x >= pos_.size()) pos_.resize(x + 1u, Position{npos, 0u});
+    if (t < last_) last_ = t;
+    if (sequence_ == UINT32_MAX) renumber();
+    insert({t, x, sequence_++});
+    ++size_;
+    if (size_ > 2u * num_buckets()) resize(2u * num_buckets());
+}
+
+void CalendarQueue::pop() {
+    const Entry& entry = front();
+    last_ = entry.time;
+    erase(entry.handle);
+    // The cost of resize() is amortized by the excess cost
+    ++pops_;
+    if (cost_ > max_cost * std::max(pops_, num_buckets())) {
+        resize(num_buckets());
+    } else if (pops_ >= num_buckets()) {
+        pops_ = 0u;
+        cost_ = 0u;
+    }
+}
+
+void CalendarQueue::erase(const uint32_t x) {
+    const Position p = pos_[x];
+    auto& bucket = buckets_[p.bucket];
+    const auto back = static_cast<uint32_t>(bucket.size() - 1u);
+    bucket[p.index] = bucket.back();
+    pos_[bucket[p.index].handle].index = p.index;
+    bucket.pop_back();
+    pos_[x].bucket = npos;
+    --size_;
+    if (front_.bucket == p.bucket) {
+        if (front_.index == p.index) {
+            front_.bucket = npos;
+        } else if (front_.index == back) {
+            front_.index = p.index;
+        }
+    }
+    if (size_ < num_buckets() / 2u && num_buckets() > 2u) {
+        resize(num_buckets() / 2u);
+    }
+}
+
+void CalendarQueue::clear() {
+    for (auto& bucket: buckets_) bucket.clear();
+    pos_.assign(pos_.size(), Position{npos, 0u});
+    size_ = 0u;
+    front_.bucket = npos;
+    sequence_ = 0u;
+}
+
+std::vector<uint32_t> CalendarQueue::handles() const {
+    std::vector<Entry> entries;
+    entries.reserve(size_);
+    for (const auto& bucket: buckets_) {
+        entries.insert(entries.end(), bucket.begin(), bucket.end());
+    }
+    std::sort(entries.begin(), entries.end(), before);
+    std::vector<uint32_t> output;
+    output.reserve(entries.size());
+    for (const auto& entry: entries) {
+        output.push_back(entry.handle);
+    }
+    return output;
+}
+
+const CalendarQueue::Entry& CalendarQueue::front() const {
+    if (front_.bucket != npos) return buckets_[front_.bucket][front_.index];
+    const size_t n = num_buckets();
+    const uint64_t today = day(last_);
+    for (uint64_t d = today; d < today + n; ++d) {
+        const auto b = static_cast<uint32_t>(d % n);
+        const auto& bucket = buckets_[b];
+        cost_ += bucket.size() + 1u;
+        uint32_t best = npos;
+        for (uint32_t i = 0u; i < bucket.size(); ++i) {
+            if (day(bucket[i].time) != d) continue;
+            if (best == npos || before(bucket[i], bucket[best])) best = i;
+        }
+        if (best != npos) {
+            front_ = {b, best};
+            return bucket[best];
+        }
+    }
+    // No event within a year; search directly
+    cost_ += size_;
+    for (uint32_t b = 0u; b < buckets_.size(); ++b) {
+        const auto& bucket = buckets_[b];
+        for (uint32_t i = 0u; i < bucket.size(); ++i) {
+            if (front_.bucket == npos
+                || before(bucket[i], buckets_[front_.bucket][front_.index])) {
+                front_ = {b, i};
+            }
+        }
+    }
+    return buckets_[front_.bucket][front_.index];
+}
+
+void CalendarQueue::insert(const Entry& entry) {
+    const size_t n = num_buckets();
+    const auto b = static_cast<uint32_t>(
+        entry.time < std::numeric_limits<double>::infinity() ? day(entry.time) % n : n);
+    auto& bucket = buckets_[b];
+    pos_[entry.handle] = {b, static_cast<uint32_t>(bucket.size())};
+    bucket.push_back(entry);
+    if (front_.bucket != npos
+        && before(entry, buckets_[front_.bucket][front_.index])) {
+        front_ = pos_[entry.handle];
+    }
+}
+
+void CalendarQueue::renumber() {
+    std::vector<Entry*> entries;
+    entries.reserve(size_);
+    for (auto& bucket: buckets_) {
+        for (auto& entry: bucket) entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry* lhs, const Entry* rhs) {
+        return lhs->sequence < rhs->sequence;
+    });
+    sequence_ = 0u;
+    for (auto* entry: entries) entry->sequence = sequence_++;
+}
+
+void CalendarQueue::resize(const size_t n) {
+    std::vector<Entry> entries;
+    entries.reserve(size_);
+    for (const auto& bucket: buckets_) {
+        entries.insert(entries.end(), bucket.begin(), bucket.end());
+    }
+    std::vector<double> times;
+    times.reserve(entries.size());
+    for (const auto& entry: entries) {
+        if (entry.time < std::numeric_limits<double>::infinity()) times.push_back(entry.time);
+    }
+    const size_t m = std::min(times.size(), sample_size);
+    if (m > 1u) {
+        std::partial_sort(times.begin(), times.begin() + m, times.end());
+        // mean gap between the earliest events, ignoring large gaps
+        const double mean = (times[m - 1u] - times[0u]) / static_cast<double>(m - 1u);
+        double sum = 0.0;
+        size_t k = 0u;
+        for (size_t i = 1u; i < m; ++i) {
+            const double gap = times[i] - times[i - 1u];
+            if (gap <= 2.0 * mean) {
+                sum += gap;
+                ++k;
+            }
+        }
+        if (sum > 0.0) width_ = 3.0 * sum / static_cast<double>(k);
+    }
+    buckets_.assign(n + 1u, {});
+    front_.bucket = npos;
+    pops_ = 0u;
+    cost_ = 0u;
+    for (const auto& entry: entries) insert(entry);
+}
+
+} // namespace tumopp
@@ -0,0 +1,274 @@
+/*! @file event_queue.hpp
+    @brief Interface of EventQueue class
+*/
+#pragma once
+#ifndef TUMOPP_EVENT_QUEUE_HPP_
+#define TUMOPP_EVENT_QUEUE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <utility>
+
+namespace tumopp {
+
+/*! @brief Base class of priority queues of cell events
+
+    Each cell handle has at most one pending event,
+    which can be cancelled or rescheduled in place.
+*/
+class EventQueue {
+  public:
+    //! Pair of time and cell handle
+    using value_type = std::pair<double, uint32_t>;
+
+    //! Schedule x at time t; x must not be queued
+    virtual void push(double t, uint32_t x) = 0;
+    //! Get the earliest event
+    virtual value_type top() const = 0;
+    //! Remove the earliest event
+    virtual void pop() = 0;
+    //! Cancel the event of x
+    virtual void erase(uint32_t x) = 0;
+    //! Reschedule the event of x to time t
+    virtual void update(uint32_t x, double t) = 0;
+    //! Check if x is queued
+    virtual bool contains(uint32_t x) const = 0;
+    //! Remove all events
+    virtual void clear() = 0;
+    //! Number of events
+    virtual size_t size() const = 0;
+    //! Handles in the order of time
+    virtual std::vector<uint32_t> handles() const = 0;
+    //! Check if no event is queued
+    bool empty() const {return size() == 0u;}
+    //! Destructor
+    virtual ~EventQueue() = default;
+};
+
+/*! @brief Red-black tree with an iterator per handle
+
+    Events with equal times are popped in the order of push().
+*/
+class MultimapQueue final: public EventQueue {
+  public:
+    void push(double t, uint32_t x) override {
+        if (x >= where_.size()) where_.resize(x + 1u, map_.end());
+        where_[x] = map_.emplace_hint(map_.end(), t, x);
+    }
+    value_type top() const override {return *map_.begin();}
+    void pop() override {
+        where_[map_.begin()->second] = map_.end();
+        map_.erase(map_.begin());
+    }
+    void erase(uint32_t x) override {
+        map_.erase(where_[x]);
+        where_[x] = map_.end();
+    }
+    void update(uint32_t x, double t) override {
+        erase(x);
+        push(t, x);
+    }
+    bool contains(uint32_t x) const override {
+        return x < where_.size() && where_[x] != map_.end();
+    }
+    void clear() override {
+        map_.clear();
+        where_.assign(where_.size(), map_.end());
+    }
+    size_t size() const override {return map_.size();}
+    std::vector<uint32_t> handles() const override;
+
+  private:
+    //! events
+    std::multimap<double, uint32_t> map_{};
+    //! position of each handle in #map_; map_.end() if not queued
+    std::vector<std::multimap<double, uint32_t>::iterator> where_{};
+};
+
+/*! @brief Implicit 4-ary min-heap indexed by handle
+
+    Entries are stored contiguously without per-event allocation.
+    The position of each handle is tracked for erase() and update().
+    Events with equal times are ordered by push() or update()
+    as in MultimapQueue.
+*/
+class HeapQueue final: public EventQueue {
+  public:
+    void push(double t, uint32_t x) override {
+        if (x >= pos_.size()) pos_.resize(x + 1u, npos);
+        heap_.push_back({t, x, next_sequence()});
+        sift_up(heap_.size() - 1u);
+    }
+    value_type top() const override {
+        return {heap_.front().time, heap_.front().handle};
+    }
+    void pop() override {remove(0u);}
+    void erase(uint32_t x) override {remove(pos_[x]);}
+    void update(uint32_t x, double t) override {
+        const size_t i = pos_[x];
+        const double old = heap_[i].time;
+        heap_[i].time = t;
+        heap_[i].sequence = next_sequence();
+        if (t < old) {
+            sift_up(i);
+        } else {
+            sift_down(i);
+        }
+    }
+    bool contains(uint32_t x) const override {
+        return x < pos_.size() && pos_[x] != npos;
+    }
+    void clear() override {
+        heap_.clear();
+        pos_.assign(pos_.size(), npos);
+        sequence_ = 0u;
+    }
+    size_t size() const override {return heap_.size();}
+    std::vector<uint32_t> handles() const override;
+
+  private:
+    //! Element of #heap_
+    struct Entry {
+        //! scheduled time
+        double time;
+        //! cell handle
+        uint32_t handle;
+        //! order of push() or update() to break ties
+        uint32_t sequence;
+    };
+    //! Number of children per node
+    static constexpr size_t arity = 4u;
+    //! Position of handles not queued
+    static constexpr uint32_t npos = UINT32_MAX;
+    //! Compare times, and then sequence numbers
+    static bool before(const Entry& lhs, const Entry& rhs) noexcept {
+        return lhs.time < rhs.time || (lhs.time == rhs.time && lhs.sequence < rhs.sequence);
+    }
+    //! Sequence number of the next push() or update()
+    uint32_t next_sequence() {
+        if (sequence_ == UINT32_MAX) renumber();
+        return sequence_++;
+    }
+    //! Reassign sequence numbers from 0 in the same order
+    void renumber();
+    //! Move heap_[i] toward the root
+    void sift_up(size_t i);
+    //! Move heap_[i] toward the leaves
+    void sift_down(size_t i);
+    //! Remove heap_[i]
+    void remove(size_t i);
+
+    //! events
+    std::vector<Entry> heap_{};
+    //! position of each handle in #heap_; npos if not queued
+    std::vector<uint32_t> pos_{};
+    //! sequence number of the next push() or update()
+    uint32_t sequence_ = 0u;
+};
+
+/*! @brief Calendar queue with automatic resizing [Brown 1988]
+
+    Events are hashed into buckets by `floor(time / width)` modulo
+    the number of buckets, like days of a year on a desk calendar.
+    top() scans the buckets from the time of the last pop() and
+    falls back to a direct search after a whole year without events.
+    Events at infinity are kept in an extra bucket out of the calendar.
+    The number of buckets follows the number of events,
+    and the width is set to about 3x the mean gap between the earliest events,
+    so that push() and pop() take amortized O(1)
+    if events are scheduled not far ahead of the current time.
+    The width is estimated again if pop() visits too many buckets or entries,
+    e.g., after the distribution of waiting times has changed.
+    Events with equal times are ordered by push() as in MultimapQueue.
+*/
+class CalendarQueue final: public EventQueue {
+  public:
+    CalendarQueue(): buckets_(3u) {}
+    void push(double t, uint32_t x) override;
+    value_type top() const override {
+        const Entry& entry = front();
+        return {entry.time, entry.handle};
+    }
+    void pop() override;
+    void erase(uint32_t x) override;
+    void update(uint32_t x, double t) override {
+        erase(x);
+        push(t, x);
+    }
+    bool contains(uint32_t x) const override {
+        return x < pos_.size() && pos_[x].bucket != npos;
+    }
+    void clear() override;
+    size_t size() const override {return size_;}
+    std::vector<uint32_t> handles() const override;
+    //! Number of buckets
+    size_t num_buckets() const noexcept {return buckets_.size() - 1u;}
+    //! Time span of a bucket
+    double width() const noexcept {return width_;}
+
+  private:
+    //! Element of #buckets_
+    struct Entry {
+        //! scheduled time
+        double time;
+        //! cell handle
+        uint32_t handle;
+        //! order of push() to break ties
+        uint32_t sequence;
+    };
+    //! Location of a handle in #buckets_
+    struct Position {
+        //! index of the bucket; npos if not queued
+        uint32_t bucket;
+        //! index within the bucket
+        uint32_t index;
+    };
+    //! Position of handles not queued
+    static constexpr uint32_t npos = UINT32_MAX;
+    //! Maximum number of events sampled to estimate #width_
+    static constexpr size_t sample_size = 25u;
+    //! Mean cost of pop() above which #width_ is estimated again
+    static constexpr size_t max_cost = 8u;
+    //! Compare times, and then sequence numbers
+    static bool before(const Entry& lhs, const Entry& rhs) noexcept {
+        return lhs.time < rhs.time || (lhs.time == rhs.time && lhs.sequence < rhs.sequence);
+    }
+    //! Reassign sequence numbers from 0 in the same order
+    void renumber();
+    //! Index of the day to which t belongs
+    uint64_t day(double t) const noexcept {
+        const double d = t / width_;
+        return d < 1.8e19 ? static_cast<uint64_t>(d) : UINT64_MAX;
+    }
+    //! Find the earliest event and cache it in #front_
+    const Entry& front() const;
+    //! Put an entry without resizing
+    void insert(const Entry& entry);
+    //! Change the number of buckets and estimate #width_
+    void resize(size_t n);
+
+    //! unsorted events of each day, followed by those at infinity
+    std::vector<std::vector<Entry>> buckets_;
+    //! position of each handle in #buckets_
+    std::vector<Position> pos_{};
+    //! number of events
+    size_t size_ = 0u;
+    //! time span of a bucket
+    double width_ = 1.0;
+    //! time of the last pop() or the earliest push() after it
+    double last_ = 0.0;
+    //! position of the earliest event; npos if unknown
+    mutable Position front_{npos, 0u};
+    //! number of pop() since the last resize()
+    size_t pops_ = 0u;
+    //! number of buckets and entries visited by front() since the last resize()
+    mutable size_t cost_ = 0u;
+    //! sequence number of the next push()
+    uint32_t sequence_ = 0u;
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_EVENT_QUEUE_HPP_
@@ -0,0 +1,75 @@
+/*! @file genealogy.cpp
+    @brief Implementation of Genealogy class
+*/
+#include "genealogy.hpp"
+
+#include <ostream>
+#include <stdexcept>
+
+namespace tumopp {
+
+std::ostream& Genealogy::write(std::ostream& ost) const {
+    TsvWriter tsv(ost);
+    for (const auto& record: records_) {
+        if (record.id() == 0u) continue;
+        record.write(tsv) << '\n';
+    }
+    tsv.flush();
+    return ost;
+}
+
+TableWriter& Genealogy::write(TableWriter& table) const {
+    for (const auto& record: records_) {
+        if (record.id() == 0u) continue;
+        record.write(table);
+    }
+    return table;
+}
+
+void Genealogy::prune(std::vector<uint32_t>* roots) {
+    if (ancestors_.empty()) throw std::logic_error("ancestors are not kept after stream()");
+    const size_t n = records_.size();
+    std::vector<uint32_t> remap(n, 0u);
+    // mark: remap[i] != 0 if i is kept
+    for (uint32_t i: *roots) {
+        while (i != 0u && remap[i] == 0u) {
+            remap[i] = 1u;
+            i = ancestors_[i];
+        }
+    }
+    // compact: ancestors precede descendants, so they are already moved
+    uint32_t tail = 1u;
+    for (size_t i = 1u; i < n; ++i) {
+        if (remap[i] == 0u) continue;
+        remap[i] = tail;
+        records_[tail] = records_[i];
+        ids_[tail] = ids_[i];
+        ancestors_[tail] = remap[ancestors_[i]];
+        ++tail;
+    }
+    records_.resize(tail);
+    records_.shrink_to_fit();
+    ids_.resize(tail);
+    ids_.shrink_to_fit();
+    ancestors_.resize(tail);
+    ancestors_.shrink_to_fit();
+    for (auto& i: *roots) i = remap[i];
+}
+
+void Genealogy::compact(std::vector<uint32_t>* roots) {
+    if (!sink_ && !table_sink_) throw std::logic_error("records are not streamed");
+    flush();
+    std::vector<uint32_t> remap(ids_.size(), 0u);
+    std::vector<unsigned> ids(1u, 0u);
+    for (auto& i: *roots) {
+        if (i != 0u && remap[i] == 0u) {
+            remap[i] = static_cast<uint32_t>(ids.size());
+            ids.push_back(ids_[i]);
+        }
+        i = remap[i];
+    }
+    ids_.swap(ids);
+    offset_ = ids_.size();
+}
+
+} // namespace tumopp
@@ -0,0 +1,142 @@
+/*! @file genealogy.hpp
+    @brief Interface of Genealogy class
+*/
+#pragma once
+#ifndef TUMOPP_GENEALOGY_HPP_
+#define TUMOPP_GENEALOGY_HPP_
+
+#include "cell.hpp"
+#include "cell_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <iosfwd>
+
+namespace tumopp {
+
+/*! @brief Append-only arena of Cell records
+
+    A record is appended when a cell divides or dies,
+    and cells in CellStore refer to their ancestors by index.
+    Index 0 is a placeholder with ID 0 for cells without ancestors.
+    prune() drops records that are not ancestors of given roots.
+    Threads may assign() records to distinct indices reserved in advance;
+    reserved records that are left unassigned keep ID 0 and are not written.
+    After stream(), records are written out in chunks as they accumulate,
+    and ancestors are no longer kept.
+    IDs are still kept for every index until compact() drops those
+    that extant cells do not refer to, so that memory is bounded by
+    the number of extant cells and history_chunk, not by the number of records.
+*/
+class Genealogy {
+  public:
+    //! Constructor: reserve index 0
+    Genealogy(): records_(1u), ids_(1u, 0u), ancestors_(1u, 0u) {}
+    //! Append the record of x and return its index;
+    //! records before it must be final, as it may spill()
+    uint32_t append(const CellStore& cells, uint32_t x, double time_of_death) {
+        records_.push_back(record(cells, x, time_of_death));
+        ids_.push_back(cells.id(x));
+        if (!ancestors_.empty()) ancestors_.push_back(cells.ancestor(x));
+        const auto i = static_cast<uint32_t>(ids_.size() - 1u);
+        spill();
+        return i;
+    }
+    //! Append n placeholders and return the index of the first
+    uint32_t reserve(size_t n) {
+        const auto first = static_cast<uint32_t>(ids_.size());
+        ids_.resize(ids_.size() + n, 0u);
+        if (!ancestors_.empty()) ancestors_.resize(ids_.size(), 0u);
+        records_.resize(ids_.size() - offset_);
+        return first;
+    }
+    //! Drop records from index n to the end; n must not precede written records
+    void truncate(size_t n) {
+        ids_.resize(n);
+        if (!ancestors_.empty()) ancestors_.resize(n);
+        records_.resize(n - offset_);
+    }
+    //! Set the record of x at a reserved index i and return i
+    uint32_t assign(uint32_t i, const CellStore& cells, uint32_t x, double time_of_death) {
+        records_[i - offset_] = record(cells, x, time_of_death);
+        ids_[i] = cells.id(x);
+        if (!ancestors_.empty()) ancestors_[i] = cells.ancestor(x);
+        return i;
+    }
+    //! Keep only roots and their ancestors; update roots to the new indices;
+    //! not after stream()
+    void prune(std::vector<uint32_t>* roots);
+    //! Write records to ost whenever n records are in memory; see spill()
+    void stream(std::ostream* ost, size_t n) {
+        sink_ = ost;
+        chunk_ = n;
+        drop_ancestors();
+    }
+    //! Write records to table whenever n records are in memory; see spill()
+    void stream(TableWriter* table, size_t n) {
+        table_sink_ = table;
+        chunk_ = n;
+        drop_ancestors();
+    }
+    //! Keep records in memory again
+    void stop_stream() noexcept {
+        sink_ = nullptr;
+        table_sink_ = nullptr;
+        chunk_ = 0u;
+    }
+    //! Write records in memory to the stream and drop them if there are enough;
+    //! all of them must be final
+    void spill() {
+        if ((!sink_ && !table_sink_) || records_.size() < chunk_) return;
+        flush();
+    }
+    //! Write all records in memory to the stream, and keep only IDs of roots;
+    //! update roots to the new indices; only after stream() and without reserved records
+    void compact(std::vector<uint32_t>* roots);
+    //! Make the record of x without appending
+    Cell record(const CellStore& cells, uint32_t x, double time_of_death = 0.0) const {
+        return Cell(cells.coord(x), cells.id(x), ids_[cells.ancestor(x)],
+                    cells.time_of_birth(x), time_of_death,
+                    cells.proliferation_capacity(x));
+    }
+    //! Number of records; only those not dropped by compact()
+    size_t size() const noexcept {return ids_.size() - 1u;}
+    //! Write records in memory in TSV without header
+    std::ostream& write(std::ostream&) const;
+    //! Write records in memory in TCF
+    TableWriter& write(TableWriter&) const;
+
+  private:
+    //! Write records in memory to the stream and drop them
+    void flush() {
+        if (sink_) write(*sink_);
+        if (table_sink_) write(*table_sink_);
+        offset_ += records_.size();
+        records_.clear();
+    }
+    //! Stop keeping #ancestors_, which are used only by prune()
+    void drop_ancestors() {
+        ancestors_.clear();
+        ancestors_.shrink_to_fit();
+    }
+
+    //! divided or dead cells from index #offset_; earlier ones are written by spill()
+    std::vector<Cell> records_;
+    //! ID of each record
+    std::vector<unsigned> ids_;
+    //! index of the ancestor of each record; empty after stream()
+    std::vector<uint32_t> ancestors_;
+    //! index of the first record in #records_
+    size_t offset_{0u};
+    //! destination of spill(); nullptr if records are kept in memory
+    std::ostream* sink_{nullptr};
+    //! destination of spill() in TCF
+    TableWriter* table_sink_{nullptr};
+    //! number of records written at once by spill()
+    size_t chunk_{0u};
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_GENEALOGY_HPP_
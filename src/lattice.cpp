@@ -0,0 +1,170 @@
+/*! @file lattice.cpp
+    @brief Implementation of Lattice class
+*/
+#include "lattice.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace tumopp {
+
+Lattice::Lattice(const unsigned d): dimensions_(d) {
+    if (d < 1u || MAX_DIM < d) {
+        throw std::runtime_error("Invalid value for dimensions");
+    }
+}
+
+void Lattice::throw_out_of_range(const coord_t& v) const {
+    std::ostringstream oss;
+    oss << "Coordinates out of range: ";
+    for (unsigned j = 0u; j < dimensions_; ++j) oss << v[j] << " ";
+    oss << "; cells must be within +-" << packed_limit(dimensions_) - 2
+        << " on every axis in " << dimensions_ << "D";
+    throw std::runtime_error(oss.str());
+}
+
+DenseLattice::DenseLattice(const unsigned d): Lattice(d) {
+    for (unsigned j = dimensions_; j < MAX_DIM; ++j) {
+        extent_[j] = 1u;
+    }
+}
+
+void DenseLattice::expand(const coord_t& v) {
+    const bool counting = counts_neighbors();
+    const int inner = counting ? 1 : 0;
+    coord_t lower = lower_;
+    auto extent = extent_;
+    for (unsigned j = 0u; j < dimensions_; ++j) {
+        margin_[j] = static_cast<unsigned>(inner);
+        if (extent_[j] == 0u) {
+            constexpr int margin = 8;
+            lower[j] = v[j] - margin;
+            extent[j] = 2 * margin;
+            continue;
+        }
+        const int upper = lower_[j] + static_cast<int>(extent_[j]);
+        if (lower_[j] + inner <= v[j] && v[j] < upper - inner) continue;
+        // grow by at least 1.5x to amortize the copy
+        const int margin = static_cast<int>(extent_[j] / 4u) + 8;
+        lower[j] = std::min(lower_[j], v[j]) - margin;
+        extent[j] = static_cast<unsigned>(std::max(upper, v[j] + 1) + margin - lower[j]);
+    }
+    const size_t n = size_t{extent[0]} * extent[1] * extent[2];
+    std::vector<uint32_t> data(n, empty);
+    std::vector<uint8_t> counts(counting ? n : 0u, 0u);
+    if (!data_.empty()) {
+        const coord_t offset = lower_ - lower;
+        for (unsigned z = 0u; z < extent_[2]; ++z) {
+            for (unsigned y = 0u; y < extent_[1]; ++y) {
+                const size_t src = (size_t{z} * extent_[1] + y) * extent_[0];
+                const size_t dst = (size_t{z + offset[2]} * extent[1] + y + offset[1]) * extent[0] + offset[0];
+                std::copy_n(data_.begin() + src, extent_[0], data.begin() + dst);
+                if (counting) {
+                    std::copy_n(counts_.begin() + src, extent_[0], counts.begin() + dst);
+                }
+            }
+        }
+    }
+    data_.swap(data);
+    counts_.swap(counts);
+    lower_ = lower;
+    extent_ = extent;
+    offsets_.clear();
+    for (const auto& d: directions_) {
+        const auto stride_z = static_cast<std::ptrdiff_t>(extent_[0]) * extent_[1];
+        offsets_.push_back(d[0] + d[1] * static_cast<std::ptrdiff_t>(extent_[0]) + d[2] * stride_z);
+    }
+}
+
+BrickLattice::BrickLattice(const unsigned d): Lattice(d) {
+    // 256 for 1D and 2D, 512 for 3D
+    constexpr std::array<unsigned, MAX_DIM> shift{{8u, 4u, 3u}};
+    shift_ = shift[dimensions_ - 1u];
+    mask_ = (1u << shift_) - 1u;
+    volume_ = size_t{1u} << (shift_ * dimensions_);
+}
+
+BrickLattice::Brick* BrickLattice::find(const packed_t key) const {
+    if (cache_ && key == cache_key_) return cache_;
+    const auto it = bricks_.find(key);
+    if (it == bricks_.end()) return nullptr;
+    cache_key_ = key;
+    return cache_ = &it->second;
+}
+
+BrickLattice::Brick* BrickLattice::find_or_allocate(const packed_t key) {
+    Brick* brick = find(key);
+    if (brick) return brick;
+    brick = &bricks_[key];
+    brick->data.assign(volume_, empty);
+    if (counts_neighbors()) brick->counts.assign(volume_, 0u);
+    cache_key_ = key;
+    return cache_ = brick;
+}
+
+void BrickLattice::add_refs(const packed_t key, Brick* brick, const int delta) {
+    brick->refs += static_cast<unsigned>(delta);
+    if (brick->refs == 0u) {
+        if (brick == cache_) cache_ = nullptr;
+        bricks_.erase(key);
+    }
+}
+
+uint32_t BrickLattice::load(const packed_t site) const {
+    unsigned i = 0u;
+    const Brick* brick = find(split(site, &i));
+    return brick ? brick->data[i] : empty;
+}
+
+unsigned BrickLattice::count(const packed_t site) const {
+    unsigned i = 0u;
+    const Brick* brick = find(split(site, &i));
+    return brick ? brick->counts[i] : 0u;
+}
+
+uint32_t BrickLattice::store(const packed_t site, const uint32_t x) {
+    unsigned i = 0u;
+    const packed_t key = split(site, &i);
+    Brick* brick = (x == empty) ? find(key) : find_or_allocate(key);
+    if (!brick) return empty;
+    const uint32_t old = brick->data[i];
+    brick->data[i] = x;
+    if ((old == empty) == (x == empty)) return old;
+    const int delta = (x == empty) ? -1 : 1;
+    for (const auto step: steps_) {
+        unsigned j = 0u;
+        const packed_t nkey = split(site + step, &j);
+        Brick* neighbor = find_or_allocate(nkey);
+        neighbor->counts[j] = static_cast<uint8_t>(neighbor->counts[j] + delta);
+        add_refs(nkey, neighbor, delta);
+    }
+    add_refs(key, brick, delta);
+    return old;
+}
+
+uint32_t HashLattice::store(const packed_t key, const uint32_t x) {
+    auto it = data_.find(key);
+    const uint32_t old = (it == data_.end()) ? empty : it->second.handle;
+    if (x != empty) {
+        if (it == data_.end()) it = data_.emplace(key, Site{}).first;
+        it->second.handle = x;
+    } else if (it != data_.end()) {
+        it->second.handle = empty;
+        if (it->second.count == 0u) data_.erase(it);
+    }
+    if ((old == empty) == (x == empty)) return old;
+    for (const auto step: steps_) {
+        if (x != empty) {
+            ++data_[key + step].count;
+        } else {
+            const auto neighbor = data_.find(key + step);
+            if (--neighbor->second.count == 0u && neighbor->second.handle == empty) {
+                data_.erase(neighbor);
+            }
+        }
+    }
+    return old;
+}
+
+} // namespace tumopp
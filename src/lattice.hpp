@@ -0,0 +1,300 @@
+/*! @file lattice.hpp
+    @brief Interface of Lattice class
+*/
+#pragma once
+#ifndef TUMOPP_LATTICE_HPP_
+#define TUMOPP_LATTICE_HPP_
+
+#include "coord.hpp"
+#include "ray_index.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+namespace tumopp {
+
+/*! @brief Base class of occupancy storage that maps coordinates to cell handles
+
+    Each site holds a compact handle of a cell, or #empty.
+    Optionally, each site also holds the number of occupied neighbors,
+    which is updated whenever a site turns from empty to occupied or back.
+    Sites are addressed by packed keys, so that walking along a direction
+    is a single addition of pack_direction();
+    coord_t overloads are provided for convenience.
+    Runs of occupied sites along each direction can also be indexed
+    for the lengths of rays to the nearest empty site; see RayIndex.
+    Cells must be put within the packable range; see is_packable().
+    exchange() throws std::runtime_error before a key would overflow.
+*/
+class Lattice {
+  public:
+    //! Handle of empty sites
+    static constexpr uint32_t empty = 0u;
+
+    //! Get the handle at a packed key; #empty if unallocated
+    uint32_t get(packed_t key) const {return load(key);}
+    //! Get the handle at v; #empty if unallocated
+    uint32_t get(const coord_t& v) const {return load(pack(v, dimensions_));}
+    //! Put x at a packed key and return the previous handle
+    uint32_t exchange(packed_t key, uint32_t x) {
+        if (x != empty && !is_packable(key, dimensions_)) throw_out_of_range(unpack(key, dimensions_));
+        const uint32_t old = store(key, x);
+        if (rays_ && (old == empty) != (x == empty)) flip(unpack(key, dimensions_), x);
+        return old;
+    }
+    //! Put x at v and return the previous handle
+    uint32_t exchange(const coord_t& v, uint32_t x) {
+        if (x != empty && !is_packable(v, dimensions_)) throw_out_of_range(v);
+        const uint32_t old = store(pack(v, dimensions_), x);
+        if (rays_ && (old == empty) != (x == empty)) flip(v, x);
+        return old;
+    }
+    //! Number of occupied neighbors of a packed key; requires count_neighbors()
+    unsigned num_occupied_neighbors(packed_t key) const {return count(key);}
+    //! Number of occupied neighbors of v; requires count_neighbors()
+    unsigned num_occupied_neighbors(const coord_t& v) const {return count(pack(v, dimensions_));}
+    //! Number of allocated sites
+    virtual size_t capacity() const = 0;
+    //! Start counting occupied neighbors; call before putting any cell
+    void count_neighbors(const std::vector<coord_t>& directions) {
+        directions_ = directions;
+        steps_.clear();
+        for (const auto& d: directions_) steps_.push_back(pack_direction(d, dimensions_));
+    }
+    //! Check if count_neighbors() is enabled
+    bool counts_neighbors() const noexcept {return !directions_.empty();}
+    //! Start indexing runs of occupied sites listed in occupied and put later
+    void index_rays(const std::vector<coord_t>& directions, const std::vector<coord_t>& occupied = {}) {
+        rays_ = std::make_unique<RayIndex>(dimensions_, directions);
+        for (const auto& v: occupied) rays_->occupy(v);
+    }
+    //! Check if index_rays() is enabled
+    bool indexes_rays() const noexcept {return bool(rays_);}
+    //! Steps from v to the nearest empty site along directions[i]; requires index_rays()
+    unsigned steps_to_empty(const coord_t& v, size_t i) const {return rays_->steps_to_empty(v, i);}
+    //! Put x at v
+    void set(const coord_t& v, uint32_t x) {exchange(v, x);}
+    //! Put #empty at v
+    void erase(const coord_t& v) {exchange(v, empty);}
+    //! Destructor
+    virtual ~Lattice() = default;
+
+  protected:
+    //! Default constructor is deleted
+    Lattice() = delete;
+    //! Constructor: check #dimensions_
+    explicit Lattice(unsigned d);
+
+    /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+    // Data member
+
+    //! {1, 2, 3}
+    const unsigned dimensions_{};
+    //! neighborhood of counting; empty if disabled
+    std::vector<coord_t> directions_{};
+    //! pack_direction() of #directions_
+    std::vector<packed_t> steps_{};
+    //! runs of occupied sites; nullptr if disabled
+    std::unique_ptr<RayIndex> rays_{nullptr};
+
+  private:
+    //! Implementation of get()
+    virtual uint32_t load(packed_t key) const = 0;
+    //! Implementation of exchange()
+    virtual uint32_t store(packed_t key, uint32_t x) = 0;
+    //! Implementation of num_occupied_neighbors()
+    virtual unsigned count(packed_t key) const = 0;
+    //! Update #rays_ after the occupancy of v has changed to x
+    void flip(const coord_t& v, uint32_t x) {
+        if (x == empty) {
+            rays_->vacate(v);
+        } else {
+            rays_->occupy(v);
+        }
+    }
+    //! Report a cell put outside the packable range
+    [[noreturn]] void throw_out_of_range(const coord_t& v) const;
+};
+
+/*! @brief Dense grid over a bounding box
+
+    The bounding box grows by at least 1.5x when a site outside it is written.
+    Fastest while the tumor is compact.
+*/
+class DenseLattice final: public Lattice {
+  public:
+    DenseLattice() = delete;
+    //! Constructor: fix #extent_ of unused axes
+    explicit DenseLattice(unsigned d);
+    ~DenseLattice() = default;
+    size_t capacity() const noexcept override {return data_.size();}
+    //! Check if writing at key neither enlarges the bounding box nor reallocates,
+    //! so that threads can write at distinct sites concurrently
+    bool is_allocated(packed_t key) const noexcept {
+        size_t i = 0u;
+        return find<true>(key, &i);
+    }
+    //! Lower corner of the bounding box
+    const coord_t& lower() const noexcept {return lower_;}
+    //! Width of the bounding box; 1 for unused axes
+    const std::array<unsigned, MAX_DIM>& extent() const noexcept {return extent_;}
+
+  private:
+    uint32_t load(packed_t key) const noexcept override {
+        size_t i = 0u;
+        return find(key, &i) ? data_[i] : empty;
+    }
+    uint32_t store(packed_t key, uint32_t x) override {
+        size_t i = 0u;
+        if (!find<true>(key, &i)) {
+            expand(unpack(key, dimensions_));
+            find(key, &i);
+        }
+        const uint32_t old = data_[i];
+        data_[i] = x;
+        if (!counts_.empty() && (old == empty) != (x == empty)) {
+            const uint8_t delta = (x == empty) ? uint8_t(-1) : uint8_t(1);
+            for (const auto offset: offsets_) {
+                counts_[static_cast<size_t>(static_cast<std::ptrdiff_t>(i) + offset)] += delta;
+            }
+        }
+        return old;
+    }
+    unsigned count(packed_t key) const noexcept override {
+        size_t i = 0u;
+        return find(key, &i) ? counts_[i] : 0u;
+    }
+    //! Set the index of a key to i and return true if it is in the bounding box.
+    //! If Inner, it must be also #margin_ away from the boundary.
+    template <bool Inner = false>
+    bool find(packed_t key, size_t* i) const noexcept {
+        size_t idx = 0u;
+        for (unsigned j = dimensions_; j-- > 0u;) {
+            const unsigned m = Inner ? margin_[j] : 0u;
+            const auto lower = static_cast<packed_t>(lower_[j] + packed_limit(dimensions_));
+            const auto offset = static_cast<unsigned>(packed_field(key, j, dimensions_) - lower) - m;
+            if (offset >= extent_[j] - 2u * m) return false;
+            idx = idx * extent_[j] + offset + m;
+        }
+        *i = idx;
+        return true;
+    }
+    //! Enlarge the bounding box to include v
+    void expand(const coord_t& v);
+
+    //! handles in x-major order
+    std::vector<uint32_t> data_{};
+    //! number of occupied neighbors in the same order as #data_
+    std::vector<uint8_t> counts_{};
+    //! index offsets of #directions_
+    std::vector<std::ptrdiff_t> offsets_{};
+    //! 1 for used axes if neighbors are counted
+    std::array<unsigned, MAX_DIM> margin_{};
+    //! lower corner of the bounding box
+    coord_t lower_{};
+    //! width of the bounding box; 1 for unused axes
+    std::array<unsigned, MAX_DIM> extent_{};
+};
+
+/*! @brief Fixed-size bricks allocated on demand
+
+    Only the brick coordinate is hashed,
+    and the last brick is cached so that neighbor lookups stay local.
+    Bricks are freed when they have neither cells nor occupied neighbors.
+    Memory is proportional to the occupied volume
+    even if the tumor is elongated or fragmented.
+*/
+class BrickLattice final: public Lattice {
+  public:
+    BrickLattice() = delete;
+    //! Constructor: set #shift_ and #mask_
+    explicit BrickLattice(unsigned d);
+    ~BrickLattice() = default;
+    size_t capacity() const noexcept override {return bricks_.size() * volume_;}
+
+  private:
+    uint32_t load(packed_t key) const override;
+    uint32_t store(packed_t key, uint32_t x) override;
+    unsigned count(packed_t key) const override;
+    //! Block of sites
+    struct Brick {
+        //! handles in x-major order
+        std::vector<uint32_t> data;
+        //! number of occupied neighbors in the same order as #data
+        std::vector<uint8_t> counts;
+        //! number of occupied sites + sum of #counts
+        unsigned refs = 0u;
+    };
+    //! Split a site key into the brick key and the index within it
+    packed_t split(packed_t key, unsigned* i) const noexcept {
+        packed_t brick_key = 0u;
+        unsigned idx = 0u;
+        for (unsigned j = dimensions_; j-- > 0u;) {
+            const packed_t field = packed_field(key, j, dimensions_);
+            brick_key |= (field >> shift_) << (packed_bits(dimensions_) * j);
+            idx = (idx << shift_) | static_cast<unsigned>(field & mask_);
+        }
+        *i = idx;
+        return brick_key;
+    }
+    //! Find a brick using #cache_
+    Brick* find(packed_t key) const;
+    //! Find or allocate a brick
+    Brick* find_or_allocate(packed_t key);
+    //! Add delta to Brick::refs and free it if unreferenced
+    void add_refs(packed_t key, Brick* brick, int delta);
+
+    //! log2 of the edge length
+    unsigned shift_{};
+    //! edge length - 1
+    unsigned mask_{};
+    //! number of sites in a brick
+    size_t volume_{};
+    //! allocated bricks
+    mutable std::unordered_map<packed_t, Brick> bricks_{};
+    //! key of the last brick
+    mutable packed_t cache_key_{};
+    //! pointer to the last brick; nullptr if not allocated
+    mutable Brick* cache_{nullptr};
+};
+
+/*! @brief Hash table of occupied sites
+
+    Every site is hashed as in std::unordered_set;
+    kept as a baseline for benchmarking the other backends.
+*/
+class HashLattice final: public Lattice {
+  public:
+    HashLattice() = delete;
+    //! Constructor
+    explicit HashLattice(unsigned d): Lattice(d) {}
+    ~HashLattice() = default;
+    size_t capacity() const noexcept override {return data_.size();}
+
+  private:
+    uint32_t load(packed_t key) const override {
+        const auto it = data_.find(key);
+        return it == data_.end() ? empty : it->second.handle;
+    }
+    uint32_t store(packed_t key, uint32_t x) override;
+    unsigned count(packed_t key) const override {
+        const auto it = data_.find(key);
+        return it == data_.end() ? 0u : it->second.count;
+    }
+    //! Value of #data_
+    struct Site {
+        //! handle of a cell
+        uint32_t handle = empty;
+        //! number of occupied neighbors
+        uint8_t count = 0u;
+    };
+    //! sites that are occupied or have occupied neighbors
+    std::unordered_map<packed_t, Site> data_{};
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_LATTICE_HPP_
@@ -0,0 +1,120 @@
+/*! @file ray_index.cpp
+    @brief Implementation of RayIndex class
+*/
+#include "ray_index.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace tumopp {
+
+RayIndex::RayIndex(const unsigned d, const std::vector<coord_t>& directions): dimensions_(d) {
+    for (const auto& direction: directions) {
+        unsigned axis = 0u;
+        while (axis < d && direction[axis] == 0) ++axis;
+        if (axis == d || std::abs(direction[axis]) != 1) {
+            throw std::runtime_error("RayIndex requires unit steps on the first non-zero axis");
+        }
+        coord_t step = direction;
+        const bool backward = direction[axis] < 0;
+        if (backward) {
+            for (auto& x: step) x = -x;
+        }
+        unsigned i = 0u;
+        while (i < families_.size() && families_[i].step != step) ++i;
+        if (i == families_.size()) families_.push_back(Family{step, axis, {}});
+        family_of_.push_back(i);
+        backward_.push_back(backward);
+    }
+}
+
+uint64_t RayIndex::line_key(const Family& family, const coord_t& v) const noexcept {
+    // The axis of the family is 0 at the crossing.
+    // In 3D, the other two axes are within +-2^22 and fit in 32 bits each.
+    uint64_t key = 0u;
+    const int64_t t = v[family.axis];
+    for (unsigned j = 0u; j < dimensions_; ++j) {
+        if (j == family.axis) continue;
+        key = (key << 32u) + static_cast<uint64_t>(v[j] - t * family.step[j]);
+    }
+    return key;
+}
+
+RayIndex::Line::const_iterator RayIndex::find(const Line& line, const int t) noexcept {
+    const auto it = std::upper_bound(line.begin(), line.end(), t,
+        [](const int value, const std::pair<int, int>& interval) {return value < interval.second;});
+    return (it != line.end() && it->first <= t) ? it : line.end();
+}
+
+void RayIndex::occupy(const coord_t& v) {
+    for (auto& family: families_) {
+        const int t = v[family.axis];
+        auto& line = family.lines[line_key(family, v)];
+        // first interval that ends at or after t
+        auto it = std::lower_bound(line.begin(), line.end(), t,
+            [](const std::pair<int, int>& interval, const int value) {return interval.second < value;});
+        if (it != line.end() && it->first <= t && t < it->second) continue;
+        const bool joins_left = (it != line.end() && it->second == t);
+        auto right = joins_left ? it + 1 : it;
+        const bool joins_right = (right != line.end() && right->first == t + 1);
+        if (joins_left && joins_right) {
+            it->second = right->second;
+            line.erase(right);
+        } else if (joins_left) {
+            it->second = t + 1;
+        } else if (joins_right) {
+            right->first = t;
+        } else {
+            line.insert(right, {t, t + 1});
+        }
+    }
+}
+
+void RayIndex::vacate(const coord_t& v) {
+    for (auto& family: families_) {
+        const int t = v[family.axis];
+        const auto found = family.lines.find(line_key(family, v));
+        if (found == family.lines.end()) continue;
+        auto& line = found->second;
+        const auto cit = find(line, t);
+        if (cit == line.end()) continue;
+        const auto it = line.begin() + (cit - line.cbegin());
+        if (it->first == t && it->second == t + 1) {
+            // empty lines are kept with their capacity for the next occupy()
+            line.erase(it);
+        } else if (it->first == t) {
+            ++it->first;
+        } else if (it->second == t + 1) {
+            --it->second;
+        } else {
+            const int last = it->second;
+            it->second = t;
+            line.insert(it + 1, {t + 1, last});
+        }
+    }
+}
+
+unsigned RayIndex::steps_to_empty(const coord_t& v, const size_t i) const {
+    const auto& family = families_[family_of_[i]];
+    const int t = v[family.axis];
+    const auto found = family.lines.find(line_key(family, v));
+    if (found == family.lines.end()) return 1u;
+    const auto& line = found->second;
+    if (backward_[i]) {
+        const auto it = find(line, t - 1);
+        return it == line.end() ? 1u : static_cast<unsigned>(t - it->first + 1);
+    }
+    const auto it = find(line, t + 1);
+    return it == line.end() ? 1u : static_cast<unsigned>(it->second - t);
+}
+
+size_t RayIndex::size() const noexcept {
+    size_t n = 0u;
+    for (const auto& family: families_) {
+        for (const auto& p: family.lines) n += !p.second.empty();
+    }
+    return n;
+}
+
+} // namespace tumopp
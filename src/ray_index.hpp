@@ -0,0 +1,74 @@
+/*! @file ray_index.hpp
+    @brief Interface of RayIndex class
+*/
+#pragma once
+#ifndef TUMOPP_RAY_INDEX_HPP_
+#define TUMOPP_RAY_INDEX_HPP_
+
+#include "coord.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <unordered_map>
+
+namespace tumopp {
+
+/*! @brief Runs of occupied sites along every line of a set of directions
+
+    Each pair of opposite directions defines a family of parallel lines.
+    A line is identified by the site where it crosses the plane of
+    its first non-zero axis, and positions on it are measured along that axis.
+    Occupied sites on each line are stored as sorted disjoint intervals,
+    so that the number of steps to the nearest empty site along a direction
+    is found without walking, and a flip of a site touches
+    only the lines through it.
+    Lines are never removed and intervals are stored in place,
+    so that flips allocate only when a line is touched for the first time
+    or holds more intervals than ever before.
+*/
+class RayIndex {
+  public:
+    RayIndex() = delete;
+    //! Constructor: pair up opposite directions
+    RayIndex(unsigned d, const std::vector<coord_t>& directions);
+    //! Record that v has become occupied
+    void occupy(const coord_t& v);
+    //! Record that v has become empty
+    void vacate(const coord_t& v);
+    //! Number of steps from v to the nearest empty site along directions[i]
+    unsigned steps_to_empty(const coord_t& v, size_t i) const;
+    //! Number of lines with occupied sites
+    size_t size() const noexcept;
+
+  private:
+    //! Occupied intervals [first, second) sorted by position
+    using Line = std::vector<std::pair<int, int>>;
+    //! Parallel lines of a pair of opposite directions
+    struct Family {
+        //! direction with a positive first non-zero axis
+        coord_t step;
+        //! first non-zero axis of #step
+        unsigned axis;
+        //! lines that have ever had occupied sites
+        std::unordered_map<uint64_t, Line> lines;
+    };
+    //! Key of the line through v
+    uint64_t line_key(const Family& family, const coord_t& v) const noexcept;
+    //! Find the interval containing t; end() if t is empty
+    static Line::const_iterator find(const Line& line, int t) noexcept;
+
+    //! {1, 2, 3}
+    const unsigned dimensions_;
+    //! families of lines
+    std::vector<Family> families_{};
+    //! index of #families_ for each direction
+    std::vector<unsigned> family_of_{};
+    //! whether each direction is opposite to Family::step
+    std::vector<bool> backward_{};
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_RAY_INDEX_HPP_
@@ -0,0 +1,145 @@
+/*! @file shortest_path.hpp
+    @brief Defines ShortestPath class
+*/
+#pragma once
+#ifndef TUMOPP_SHORTEST_PATH_HPP_
+#define TUMOPP_SHORTEST_PATH_HPP_
+
+#include "coord.hpp"
+#include "lattice.hpp"
+#include "surface.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace tumopp {
+
+/*! @brief Best-first search of a shortest path to the nearest empty site for -P shortest
+
+    Sites are visited in order of depth + SurfaceDistance::lower_bound(),
+    which never decreases along a path,
+    within a window of radius() steps around the origin.
+    The window is indexed by offsets from its center,
+    and visited sites are stamped with the generation of the search,
+    so that nothing is cleared or allocated between searches.
+*/
+class ShortestPath {
+  public:
+    //! Radius of the search window
+    static constexpr int radius(unsigned dimensions) noexcept {
+        return dimensions == 1u ? 1024 : (dimensions == 2u ? 32 : 12);
+    }
+
+    //! Search a shortest path from v to the nearest empty site within radius();
+    //! false if the lower bound of v exceeds radius() or no empty site is found;
+    //! ties are broken by directions shuffled with engine
+    template <class C, class URBG>
+    bool find(const coord_t& v, const Lattice& lattice, SurfaceDistance& surface, URBG& engine) {
+        constexpr auto& steps = C::packed_table;
+        constexpr size_t n = steps.size();
+        constexpr int r = radius(C::num_dimensions);
+        constexpr auto width = static_cast<size_t>(2 * r + 1);
+        path_.clear();
+        const unsigned bound = surface.lower_bound(v, lattice);
+        if (static_cast<int>(bound) > r) return false;
+        std::array<std::ptrdiff_t, n> offsets{};
+        size_t volume = 1u;
+        uint32_t center = 0u;
+        for (unsigned j = 0u; j < C::num_dimensions; ++j) {
+            for (size_t i = 0u; i < n; ++i) {
+                offsets[i] += C::table[i][j] * static_cast<std::ptrdiff_t>(volume);
+            }
+            center += static_cast<uint32_t>(r * volume);
+            volume *= width;
+        }
+        if (visited_.size() != volume) {
+            visited_.assign(volume, 0u);
+            depth_.assign(volume, 0u);
+            parent_.assign(volume, 0u);
+            buckets_.resize(static_cast<size_t>(r) + 1u);
+            generation_ = 0u;
+        }
+        // stamps are cleared only when the generation wraps around
+        if (++generation_ == 0u) {
+            std::fill(visited_.begin(), visited_.end(), 0u);
+            generation_ = 1u;
+        }
+        for (auto& bucket: buckets_) bucket.clear();
+        std::array<uint8_t, n> indices{};
+        std::iota(indices.begin(), indices.end(), uint8_t{0u});
+        std::shuffle(indices.begin(), indices.end(), engine);
+        visited_[center] = generation_;
+        depth_[center] = 0u;
+        buckets_[bound].push_back(Node{pack<C>(v), center, 0u});
+        // nodes deeper than the radius are not pushed, so that they stay within the window
+        Node found{0u, center, 0u};
+        for (size_t f = bound; f < buckets_.size() && found.index == center;) {
+            if (buckets_[f].empty()) {
+                ++f;
+                continue;
+            }
+            const Node node = buckets_[f].back();
+            buckets_[f].pop_back();
+            if (node.depth > depth_[node.index]) continue;  // reached by a shorter path later
+            if (node.index != center && lattice.get(node.key) == Lattice::empty) {
+                found = node;
+                break;
+            }
+            const uint16_t depth = node.depth + 1u;
+            if (depth > r) continue;
+            for (const auto i: indices) {
+                const auto index = static_cast<uint32_t>(node.index + offsets[i]);
+                if (visited_[index] == generation_ && depth_[index] <= depth) continue;
+                const packed_t key = node.key + steps[i];
+                const unsigned h = (lattice.get(key) == Lattice::empty) ? 0u
+                                 : surface.lower_bound(unpack(key, C::num_dimensions), lattice);
+                if (depth + h > static_cast<unsigned>(r)) continue;
+                visited_[index] = generation_;
+                depth_[index] = depth;
+                parent_[index] = i;
+                buckets_[depth + h].push_back(Node{key, index, depth});
+            }
+        }
+        if (found.index == center) return false;
+        for (Node node = found; node.index != center;) {
+            path_.push_back(node.key);
+            const auto i = parent_[node.index];
+            node.key -= steps[i];
+            node.index = static_cast<uint32_t>(node.index - offsets[i]);
+        }
+        return true;
+    }
+    //! Sites along the path of the last find(), from the empty end; the origin is excluded
+    const std::vector<packed_t>& path() const noexcept {return path_;}
+
+  private:
+    //! Site visited by find()
+    struct Node {
+        //! packed coordinates
+        packed_t key;
+        //! index in the search window
+        uint32_t index;
+        //! number of steps from the origin
+        uint16_t depth;
+    };
+    //! generation of the last search
+    uint32_t generation_{0u};
+    //! generation in which each site of the search window was visited
+    std::vector<uint32_t> visited_{};
+    //! number of steps from the origin to each site of the search window
+    std::vector<uint16_t> depth_{};
+    //! index of the direction from the parent of each site of the search window
+    std::vector<uint8_t> parent_{};
+    //! sites to visit, by depth + SurfaceDistance::lower_bound()
+    std::vector<std::vector<Node>> buckets_{};
+    //! sites along the path found by find(), from the empty end
+    std::vector<packed_t> path_{};
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_SHORTEST_PATH_HPP_
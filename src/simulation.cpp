@@ -4,22 +4,32 @@
 */
 #include "simulation.hpp"
 #include "tissue.hpp"
-#include "cell.hpp"
+#include "cell_store.hpp"
+#include "table.hpp"
 #include "random.hpp"
 #include "version.hpp"
 
 #include <wtl/zlib.hpp>
 #include <wtl/iostr.hpp>
 #include <wtl/chrono.hpp>
+#include <wtl/algorithm.hpp>
 #include <clippson/clippson.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
 
 namespace tumopp {
 
-//! Global variables mapper of command-line arguments
-nlohmann::json VM;
+//! Variables mapper of command-line arguments
+class VariablesMap: public nlohmann::json {};
 
 //! Options description for general purpose
 inline clipp::group general_options(nlohmann::json* vm) {
@@ -38,14 +48,21 @@ inline clipp::group general_options(nlohmann::json* vm) {
     `-C,--coord`        | -              | -
     `-L,--local`        | \f$E_2\f$      | -
     `-P,--path`         | -              | -
+    `--lattice`         | -              | -
+    `--queue`           | -              | -
+    `--engine`          | -              | -
     `-O,--origin`       | \f$N_0\f$      | -
     `-N,--max`          | \f$N_\max\f$   | -
     `-T,--plateau`      | -              | -
+    `--prune`           | -              | -
     `-U,--mutate`       | \f$N_\mu\f$    | -
     `-o,--outdir`       | -              | -
+    `--format`          | -              | -
     `-I,--interval`     | -              | -
     `-R,--record`       | -              | -
     `--seed`            | -              | -
+    `--replicates`      | -              | -
+    `-j,--threads`      | -              | -
 */
 inline clipp::group simulation_options(nlohmann::json* vm) {
     const std::string OUT_DIR = wtl::strftime("tumopp_%Y%m%d_%H%M%S");
@@ -63,7 +80,21 @@ inline clipp::group simulation_options(nlohmann::json* vm) {
       clippson::option(vm, {"P", "path"},
         "random",
         "Push method"
-        " {random, roulette, mindrag, minstraight, stroll}"), // TODO
+        " {random, roulette, mindrag, minstraight, stroll, shortest}"), // TODO
+      clippson::option(vm, {"lattice"},
+        "dense",
+        "Occupancy storage"
+        " {dense, brick, hash}"),
+      clippson::option(vm, {"queue"},
+        "heap",
+        "Event queue"
+        " {heap, calendar, multimap}"),
+      clippson::option(vm, {"engine"},
+        "serial",
+        "Growth of a tumor; conservative is experimental,"
+        " for -L step/linear -P mindrag with --lattice dense;"
+        " its results are reproducible for the same --seed and -j"
+        " {serial, conservative}"),
       clippson::option(vm, {"O", "origin"}, 1u),
       clippson::option(vm, {"N", "max"}, 16384u,
         "Maximum number of cells to simulate"),
@@ -73,9 +104,16 @@ inline clipp::group simulation_options(nlohmann::json* vm) {
         "Duration of turn-over phase after population growth"),
       clippson::option(vm, {"U", "mutate"}, 0u,
         "Introduce a driver mutation to U-th cell"),
+      clippson::option(vm, {"prune"}, false,
+        "Drop dead lineages without extant descendants"),
       clippson::option(vm, {"treatment"}, 0.0),
       clippson::option(vm, {"resistant"}, 3u),
       clippson::option(vm, {"o", "outdir"}, OUT_DIR),
+      clippson::option(vm, {"format"},
+        "tsv",
+        "Output of population, snapshots, and drivers;"
+        " tcf is binary columnar, see tumopp-tcf"
+        " {tsv, tcf}"),
       clippson::option(vm, {"I", "interval"}, 0.0,
         "Time interval to take snapshots"),
       clippson::option(vm, {"R", "record"}, 0u,
@@ -84,6 +122,12 @@ inline clipp::group simulation_options(nlohmann::json* vm) {
         "Maximum number of trials in case of extinction"),
       clippson::option(vm, {"benchmark"}, false),
       clippson::option(vm, {"seed"}, seed),
+      clippson::option(vm, {"replicates"}, 1u,
+        "Number of independent runs with seeds drawn from --seed"),
+      clippson::option(vm, {"j", "threads"}, 1u,
+        "Number of threads for --replicates, extinction trials, or --engine; 0 to use all cores."
+        " Replicates and trials run in parallel are kept in memory at once,"
+        " multiplying peak memory by up to this number"),
       clippson::option(vm, {"v", "verbose"}, false, "Verbose output")
     ).doc("Simulation:");
 }
@@ -145,20 +189,64 @@ cell_options(nlohmann::json* vm, EventRates* init_event_rates, CellParams* cell_
     ).doc("Cell:");
 }
 
+//! File extension of tables in `--format`
+inline std::string table_extension(const std::string& format) {
+    std::unordered_map<std::string, std::string> swtch;
+    swtch["tsv"] = ".tsv.gz";
+    swtch["tcf"] = ".tcf";
+    try {
+        return swtch.at(format);
+    } catch (std::exception& e) {
+        std::ostringstream oss;
+        oss << "\n" << __FILE__ << ':' << __LINE__ << ':' << __PRETTY_FUNCTION__
+            << "\nInvalid value for --format (" << format << "); choose from "
+            << wtl::keys(swtch);
+        throw std::runtime_error(oss.str());
+    }
+}
+
+//! Reject options that `--engine` does not support
+inline void check_engine(const VariablesMap& vm) {
+    const auto engine = vm.at("engine").get<std::string>();
+    if (engine == "serial") return;
+    if (engine != "conservative") {
+        throw std::runtime_error("Invalid value for --engine (" + engine + "); choose from [serial, conservative]");
+    }
+    const auto local = vm.at("local").get<std::string>();
+    std::ostringstream oss;
+    if (local != "step" && local != "linear") {
+        oss << " -L " << local;
+    }
+    if (vm.at("path").get<std::string>() != "mindrag") {
+        oss << " -P " << vm.at("path").get<std::string>();
+    }
+    if (vm.at("lattice").get<std::string>() != "dense") {
+        oss << " --lattice " << vm.at("lattice").get<std::string>();
+    }
+    if (vm.at("interval").get<double>() > 0.0) oss << " -I";
+    if (vm.at("record").get<size_t>() > 0u) oss << " -R";
+    if (vm.at("mutate").get<size_t>() > 0u) oss << " -U";
+    if (!oss.str().empty()) {
+        throw std::runtime_error("--engine conservative does not support" + oss.str()
+                                 + "; it requires -L step/linear -P mindrag --lattice dense"
+                                 " without -I, -R, or -U");
+    }
+}
+
 Simulation::Simulation(const std::vector<std::string>& arguments)
-: init_event_rates_(std::make_unique<EventRates>()),
+: vm_(std::make_unique<VariablesMap>()),
+  init_event_rates_(std::make_unique<EventRates>()),
   cell_params_(std::make_unique<CellParams>()) {
     std::ios::sync_with_stdio(false);
     std::cin.tie(0);
     std::cout.precision(9);
     std::cerr.precision(6);
 
-    VM.clear();
     nlohmann::json vm_local;
     auto cli = (
       general_options(&vm_local),
-      simulation_options(&VM),
-      cell_options(&VM, init_event_rates_.get(), cell_params_.get())
+      simulation_options(vm_.get()),
+      cell_options(vm_.get(), init_event_rates_.get(), cell_params_.get())
     );
     clippson::parse(cli, arguments);
     if (vm_local["help"]) {
@@ -171,85 +259,262 @@ Simulation::Simulation(const std::vector<std::string>& arguments)
         std::cout << PROJECT_VERSION << "\n";
         throw exit_success();
     }
-    Cell::param(*cell_params_);
-    config_ = VM.dump(2) + "\n";
+    table_extension(vm_->at("format").get<std::string>());
+    check_engine(*vm_);
+    config_ = vm_->dump(2) + "\n";
 }
 
 Simulation::~Simulation() = default;
 
 void Simulation::run() {
-    const auto max_size = VM.at("max").get<size_t>();
-    const double max_time = VM.at("max_time").get<double>();
-    const auto plateau_time = VM.at("plateau").get<double>();
-    const auto treatment = VM.at("treatment").get<double>();
-    const auto resistant = VM.at("resistant").get<size_t>();
-    const auto allowed_extinction = VM.at("extinction").get<unsigned>();
-    urbg_t seeder(VM.at("seed").get<uint32_t>());
-    for (size_t i=0; i<allowed_extinction; ++i) {
-        tissue_ = std::make_unique<Tissue>(
-            VM.at("origin").get<size_t>(),
-            VM.at("dimensions").get<unsigned>(),
-            VM.at("coord").get<std::string>(),
-            VM.at("local").get<std::string>(),
-            VM.at("path").get<std::string>(),
-            *init_event_rates_,
-            seeder(),
-            VM.at("verbose").get<bool>(),
-            VM.at("benchmark").get<bool>()
-        );
-        bool success = tissue_->grow(
-            max_size,
-            max_time > 0.0 ? max_time : std::log2(max_size) * 100.0,
-            VM.at("interval").get<double>(),
-            VM.at("record").get<size_t>(),
-            VM.at("mutate").get<size_t>()
-        );
-        if (success) break;
-        std::cerr << "Trial " << i  << ": size = " << tissue_->size() << std::endl;
+    const auto replicates = vm_->at("replicates").get<unsigned>();
+    if (replicates > 1u) {
+        run_replicates(replicates);
+        return;
     }
-    if (max_time == 0.0 && tissue_->size() != max_size) {
-        std::cerr << "Warning: size = " << tissue_->size() << std::endl;
+    const auto outdir = vm_->at("outdir").get<std::filesystem::path>();
+    if (!outdir.empty()) std::filesystem::create_directory(outdir);
+    tissue_ = grow(vm_->at("seed").get<uint32_t>(), num_threads(), outdir);
+}
+
+unsigned Simulation::num_threads() const {
+    const auto n = vm_->at("threads").get<unsigned>();
+    return n > 0u ? n : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+std::unique_ptr<Tissue> Simulation::grow(const uint32_t seed, const unsigned num_threads,
+                                         const std::filesystem::path& outdir) const {
+    const auto& vm = *vm_;
+    const auto max_size = vm.at("max").get<size_t>();
+    const double max_time = vm.at("max_time").get<double>();
+    const auto plateau_time = vm.at("plateau").get<double>();
+    const auto treatment = vm.at("treatment").get<double>();
+    const auto resistant = vm.at("resistant").get<size_t>();
+    // trials are speculated only if the tumor can go extinct
+    const bool mortal = init_event_rates_->death_rate > 0.0 || init_event_rates_->death_prob > 0.0;
+    // threads grow a single tumor with the other engines
+    const bool serial = vm.at("engine").get<std::string>() == "serial";
+    auto tissue = grow_trials(seed, (serial && mortal) ? num_threads : 1u, serial ? 1u : num_threads, outdir);
+    if (max_time == 0.0 && tissue->size() != max_size) {
+        std::cerr << "Warning: size = " << tissue->size() << std::endl;
     }
     if (max_time == 0.0 && plateau_time > 0.0) {
-        tissue_->plateau(plateau_time);
+        tissue->plateau(plateau_time);
     }
     if (max_time == 0.0 && treatment > 0.0) {
         const size_t margin = 10u * resistant + 10u;
-        tissue_->treatment(treatment, resistant);
-        tissue_->grow(
-            tissue_->size() + margin,
+        tissue->treatment(treatment, resistant);
+        tissue->grow(
+            tissue->size() + margin,
             std::numeric_limits<double>::max(),
-            VM.at("interval").get<double>()
+            vm.at("interval").get<double>()
         );
     }
+    return tissue;
+}
+
+std::unique_ptr<Tissue> Simulation::grow_trials(const uint32_t seed, const unsigned num_threads,
+                                               const unsigned num_domains,
+                                               const std::filesystem::path& outdir) const {
+    const auto& vm = *vm_;
+    const auto max_size = vm.at("max").get<size_t>();
+    const double max_time = vm.at("max_time").get<double>();
+    const auto n = std::max(vm.at("extinction").get<size_t>(), size_t{1u});
+    urbg_t seeder(seed);
+    std::vector<uint32_t> seeds(n);
+    for (auto& x: seeds) x = static_cast<uint32_t>(seeder());
+    // Guarded by mtx: trials in progress, the lowest successful trial, and sizes of failed trials.
+    std::mutex mtx;
+    std::vector<std::unique_ptr<Tissue>> trials(n);
+    size_t winner = n;
+    std::vector<size_t> sizes(n, 0u);
+    std::exception_ptr error = nullptr;
+    std::atomic<size_t> next{0u};
+    // Trials are taken in seed order; a trial is cancelled when a lower one succeeds,
+    // so that the result is the same as trying one by one.
+    auto worker = [&]() {
+        while (true) {
+            const size_t i = next++;
+            try {
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (i >= winner || error) break;
+                }
+                auto trial = std::make_unique<Tissue>(
+                    vm.at("origin").get<size_t>(),
+                    vm.at("dimensions").get<unsigned>(),
+                    vm.at("coord").get<std::string>(),
+                    vm.at("local").get<std::string>(),
+                    vm.at("path").get<std::string>(),
+                    vm.at("lattice").get<std::string>(),
+                    vm.at("queue").get<std::string>(),
+                    *init_event_rates_,
+                    *cell_params_,
+                    seeds[i],
+                    vm.at("verbose").get<bool>(),
+                    vm.at("benchmark").get<bool>(),
+                    vm.at("prune").get<bool>(),
+                    vm.at("engine").get<std::string>(),
+                    num_domains
+                );
+                // each trial has its own file until write()
+                if (!outdir.empty() && !vm.at("prune").get<bool>()) {
+                    const auto& format = vm.at("format").get<std::string>();
+                    const auto name = "population_" + std::to_string(i) + table_extension(format) + ".part";
+                    trial->stream_history((outdir / name).string(), format == "tcf");
+                }
+                Tissue* tissue = trial.get();
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (i >= winner || error) break;
+                    trials[i] = std::move(trial);
+                }
+                const bool success = tissue->grow(
+                    max_size,
+                    max_time > 0.0 ? max_time : std::log2(max_size) * 100.0,
+                    vm.at("interval").get<double>(),
+                    vm.at("record").get<size_t>(),
+                    vm.at("mutate").get<size_t>()
+                );
+                std::lock_guard<std::mutex> lock(mtx);
+                if (success && i < winner) {
+                    winner = i;
+                    for (size_t j = i + 1u; j < n; ++j) {
+                        if (trials[j]) trials[j]->cancel();
+                    }
+                }
+                sizes[i] = tissue->size();
+                // the last one is returned if all trials fail
+                if (i != winner && i + 1u < n) trials[i].reset();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) error = std::current_exception();
+                for (auto& trial: trials) {
+                    if (trial) trial->cancel();
+                }
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1u; i < std::min<size_t>(num_threads, n); ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& thread: pool) thread.join();
+    if (error) std::rethrow_exception(error);
+    for (size_t i = 0u; i < winner; ++i) {
+        std::cerr << "Trial " << i  << ": size = " << sizes[i] << std::endl;
+    }
+    return std::move(trials[std::min(winner, n - 1u)]);
+}
+
+void Simulation::run_replicates(const unsigned replicates) const {
+    namespace fs = std::filesystem;
+    const auto outdir = vm_->at("outdir").get<fs::path>();
+    if (!outdir.empty()) fs::create_directory(outdir);
+    // Seeds are drawn in advance so that results do not depend on scheduling.
+    urbg_t seeder(vm_->at("seed").get<uint32_t>());
+    std::vector<int> seeds(replicates);
+    for (auto& seed: seeds) seed = static_cast<int>(static_cast<uint32_t>(seeder()));
+    const auto width = static_cast<int>(std::to_string(replicates - 1u).size());
+    const auto num_threads = std::min(this->num_threads(), replicates);
+    std::atomic<unsigned> next{0u};
+    std::exception_ptr error = nullptr;
+    std::mutex mtx;
+    // Idle threads take the next replicate,
+    // so that large ones or those with many extinctions do not hold up the others.
+    auto worker = [&]() {
+        while (true) {
+            const unsigned i = next++;
+            if (i >= replicates) break;
+            try {
+                fs::path subdir;
+                if (!outdir.empty()) {
+                    std::ostringstream name;
+                    name << "rep_" << std::setw(width) << std::setfill('0') << i;
+                    subdir = outdir / name.str();
+                    fs::create_directory(subdir);
+                }
+                const auto tissue = grow(static_cast<uint32_t>(seeds[i]), 1u, subdir);
+                if (outdir.empty()) continue;
+                // config.json reproduces this replicate alone
+                VariablesMap vm = *vm_;
+                vm["seed"] = seeds[i];
+                vm["replicates"] = 1u;
+                vm["outdir"] = subdir.string();
+                std::ofstream{subdir / "config.json"} << vm.dump(2) << "\n";
+                write(subdir, *tissue, vm.at("format").get<std::string>());
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) error = std::current_exception();
+                next = replicates;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1u; i < num_threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& thread: pool) thread.join();
+    if (error) std::rethrow_exception(error);
 }
 
 //! Write config and simulation result to files
 void Simulation::write() const {
     namespace fs = std::filesystem;
-    const auto& outdir = VM.at("outdir").get<fs::path>();
+    const auto& outdir = vm_->at("outdir").get<fs::path>();
     if (outdir.empty()) return;
     fs::create_directory(outdir);
     std::ofstream{outdir / "config.json"} << config_;
-    {
-        wtl::zlib::ofstream ofs{outdir / "population.tsv.gz"};
+    if (tissue_) write(outdir, *tissue_, vm_->at("format").get<std::string>());
+}
+
+void Simulation::write(const std::filesystem::path& outdir, Tissue& tissue,
+                       const std::string& format) {
+    const auto extension = table_extension(format);
+    const bool columnar = (format == "tcf");
+    const auto population = outdir / ("population" + extension);
+    if (tissue.streams_history()) {
+        tissue.finish_history(population.string());
+    } else if (columnar) {
+        TableWriter table(population.string(), Cell::columns());
+        tissue.write_history(table);
+        table.close();
+    } else {
+        wtl::zlib::ofstream ofs{population};
         ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-        tissue_->write_history(ofs);
+        tissue.write_history(ofs);
     }
-    if (tissue_->has_snapshots()) {
-        wtl::zlib::ofstream ofs{outdir / "snapshots.tsv.gz"};
-        ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-        tissue_->write_snapshots(ofs);
+    if (tissue.has_snapshots()) {
+        const auto path = outdir / ("snapshots" + extension);
+        if (columnar) {
+            TableWriter table(path.string(), Tissue::snapshot_columns());
+            tissue.write_snapshots(table);
+            table.close();
+        } else {
+            wtl::zlib::ofstream ofs{path};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+            tissue.write_snapshots(ofs);
+        }
     }
-    if (tissue_->has_drivers()) {
-        wtl::zlib::ofstream ofs{outdir / "drivers.tsv.gz"};
-        ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-        tissue_->write_drivers(ofs);
+    if (tissue.has_drivers()) {
+        const auto path = outdir / ("drivers" + extension);
+        if (columnar) {
+            TableWriter table(path.string(), Tissue::driver_columns());
+            tissue.write_drivers(table);
+            table.close();
+        } else {
+            wtl::zlib::ofstream ofs{path};
+            ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+            tissue.write_drivers(ofs);
+        }
     }
-    if (tissue_->has_benchmark()) {
+    if (tissue.has_benchmark()) {
         wtl::zlib::ofstream ofs{outdir / "benchmark.tsv.gz"};
         ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-        tissue_->write_benchmark(ofs);
+        tissue.write_benchmark(ofs);
+    }
+    if (tissue.has_benchmark()) {
+        wtl::zlib::ofstream ofs{outdir / "push_chains.tsv.gz"};
+        ofs.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+        tissue.write_push_chains(ofs);
     }
 }
 
@@ -9,19 +9,25 @@
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <filesystem>
 
 namespace tumopp {
 
 class Tissue;
 struct EventRates;
 struct CellParams;
+class VariablesMap;
 
 class exit_success: public std::logic_error {
   public:
     exit_success() noexcept: std::logic_error("") {}
 };
 
-/*! @brief Represents single run
+/*! @brief Represents single run or a batch of replicates
+
+    With `--replicates` larger than 1,
+    run() grows independent tissues on a pool of threads,
+    and writes each of them to its own subdirectory of `--outdir`.
 */
 class Simulation {
   public:
@@ -39,10 +45,29 @@ class Simulation {
 
     /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
   private:
+    //! Number of threads from `--threads`
+    unsigned num_threads() const;
+    //! Grow a tissue, and then apply plateau and treatment;
+    //! its history is streamed to outdir unless it is empty
+    std::unique_ptr<Tissue> grow(uint32_t seed, unsigned num_threads,
+                                 const std::filesystem::path& outdir = {}) const;
+    //! Grow tissues with seeds drawn from seed until one survives;
+    //! trials run in parallel, and the first success in seed order is returned;
+    //! each trial is grown with num_domains threads by `--engine`
+    std::unique_ptr<Tissue> grow_trials(uint32_t seed, unsigned num_threads, unsigned num_domains,
+                                        const std::filesystem::path& outdir) const;
+    //! Run and write replicates on a pool of threads
+    void run_replicates(unsigned replicates) const;
+    //! Write results of a tissue to outdir in `--format`
+    static void write(const std::filesystem::path& outdir, Tissue& tissue,
+                      const std::string& format);
+
     /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
     // Data member
 
-    //! Tissue instance
+    //! Variables mapper of command-line arguments
+    std::unique_ptr<VariablesMap> vm_{nullptr};
+    //! Tissue instance; null after run() with replicates
     std::unique_ptr<Tissue> tissue_{nullptr};
     //! EventRates instance
     std::unique_ptr<EventRates> init_event_rates_{nullptr};
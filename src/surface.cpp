@@ -0,0 +1,147 @@
+/*! @file surface.cpp
+    @brief Implementation of SurfaceDistance class
+*/
+#include "surface.hpp"
+#include "cell_store.hpp"
+#include "lattice.hpp"
+
+#include <algorithm>
+
+namespace tumopp {
+
+void SurfaceDistance::build(const Lattice& lattice, const CellStore& cells) {
+    const unsigned d = coord_.dimensions();
+    built_size_ = cells.size();
+    holes_.clear();
+    data_.clear();
+    extent_.fill(0u);
+    if (built_size_ == 0u) return;
+    coord_t upper{};
+    bool first = true;
+    for (uint32_t x = 1u; x < cells.slots(); ++x) {
+        if (!cells.contains(x)) continue;
+        const auto& v = cells.coord(x);
+        if (first) {
+            lower_ = upper = v;
+            first = false;
+        }
+        for (unsigned j = 0u; j < d; ++j) {
+            lower_[j] = std::min(lower_[j], v[j]);
+            upper[j] = std::max(upper[j], v[j]);
+        }
+    }
+    // one layer of empty sites around the cells
+    size_t n = 1u;
+    std::array<size_t, MAX_DIM> stride{};
+    for (unsigned j = 0u; j < MAX_DIM; ++j) {
+        if (j < d) {
+            lower_[j] -= 1;
+            extent_[j] = static_cast<unsigned>(upper[j] - lower_[j] + 2);
+        } else {
+            lower_[j] = 0;
+            extent_[j] = 1u;
+        }
+        stride[j] = n;
+        n *= extent_[j];
+    }
+    offsets_.clear();
+    for (const auto& direction: coord_.directions()) {
+        std::ptrdiff_t offset = 0;
+        for (unsigned j = 0u; j < d; ++j) {
+            offset += direction[j] * static_cast<std::ptrdiff_t>(stride[j]);
+        }
+        offsets_.push_back(offset);
+    }
+    data_.resize(n);
+    coord_t v = lower_;
+    for (size_t i = 0u; i < n; ++i) {
+        data_[i] = (lattice.get(v) == Lattice::empty) ? 0u : unknown;
+        for (unsigned j = 0u; j < d; ++j) {
+            if (++v[j] < lower_[j] + static_cast<int>(extent_[j])) break;
+            v[j] = lower_[j];
+        }
+    }
+    // occupied sites are never on the boundary of the box
+    frontier_.clear();
+    for (size_t i = 0u; i < n; ++i) {
+        if (data_[i] != unknown) continue;
+        for (const auto offset: offsets_) {
+            if (data_[static_cast<size_t>(static_cast<std::ptrdiff_t>(i) + offset)] == 0u) {
+                data_[i] = 1u;
+                frontier_.push_back(i);
+                break;
+            }
+        }
+    }
+    for (size_t head = 0u; head < frontier_.size(); ++head) {
+        const size_t i = frontier_[head];
+        const auto next = static_cast<uint16_t>(std::min(data_[i] + 1, unknown - 1));
+        for (const auto offset: offsets_) {
+            const auto neighbor = static_cast<size_t>(static_cast<std::ptrdiff_t>(i) + offset);
+            if (data_[neighbor] == unknown) {
+                data_[neighbor] = next;
+                frontier_.push_back(neighbor);
+            }
+        }
+    }
+    frontier_.clear();
+    frontier_.shrink_to_fit();
+}
+
+unsigned SurfaceDistance::lower_bound(const coord_t& v, const Lattice& lattice) {
+    size_t i = 0u;
+    unsigned bound = find(v, &i) ? data_[i] : 0u;
+    for (size_t k = 0u; k < holes_.size() && bound > 0u;) {
+        if (lattice.get(holes_[k]) != Lattice::empty) {
+            holes_[k] = holes_.back();
+            holes_.pop_back();
+            continue;
+        }
+        bound = std::min(bound, static_cast<unsigned>(coord_.graph_distance(holes_[k] - v)));
+        ++k;
+    }
+    return bound;
+}
+
+void SurfaceDistance::vacate(const coord_t& v) {
+    size_t i = 0u;
+    // sites with 0 include the boundary of the box
+    if (!find(v, &i) || data_[i] == 0u) return;
+    frontier_.assign(1u, i);
+    previous_.assign(1u, data_[i]);
+    data_[i] = 0u;
+    for (size_t head = 0u; head < frontier_.size(); ++head) {
+        if (frontier_.size() > max_relaxation) {
+            // Partial updates would break the 1-Lipschitz continuity
+            // on which the early termination of later calls relies.
+            for (size_t k = frontier_.size(); k-- > 0u;) {
+                data_[frontier_[k]] = previous_[k];
+            }
+            holes_.push_back(v);
+            return;
+        }
+        const size_t u = frontier_[head];
+        const auto next = static_cast<uint16_t>(data_[u] + 1u);
+        for (const auto offset: offsets_) {
+            const auto neighbor = static_cast<size_t>(static_cast<std::ptrdiff_t>(u) + offset);
+            if (data_[neighbor] > next) {
+                frontier_.push_back(neighbor);
+                previous_.push_back(data_[neighbor]);
+                data_[neighbor] = next;
+            }
+        }
+    }
+}
+
+bool SurfaceDistance::find(const coord_t& v, size_t* i) const noexcept {
+    size_t idx = 0u;
+    for (unsigned j = MAX_DIM; j-- > 0u;) {
+        const auto offset = static_cast<unsigned>(v[j] - lower_[j]);
+        if (offset >= extent_[j]) return false;
+        idx = idx * extent_[j] + offset;
+    }
+    *i = idx;
+    return true;
+}
+
+} // namespace tumopp
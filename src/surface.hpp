@@ -0,0 +1,82 @@
+/*! @file surface.hpp
+    @brief Interface of SurfaceDistance class
+*/
+#pragma once
+#ifndef TUMOPP_SURFACE_HPP_
+#define TUMOPP_SURFACE_HPP_
+
+#include "coord.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tumopp {
+
+class CellStore;
+class Lattice;
+
+/*! @brief Lower bounds of the graph distance from each site to the nearest empty site
+
+    build() runs a breadth-first search from the empty sites
+    in the bounding box of the cells plus one layer;
+    sites outside the box are regarded as empty.
+    The distances remain lower bounds while empty sites are filled,
+    so that they are rebuilt only when the number of cells has doubled.
+    When a site becomes empty, smaller distances are propagated from it
+    if it takes at most #max_relaxation updates;
+    otherwise the site is kept in #holes_ instead,
+    and lower_bound() also takes the graph distance to each hole.
+*/
+class SurfaceDistance {
+  public:
+    SurfaceDistance() = delete;
+    //! Constructor
+    explicit SurfaceDistance(const Coord& coord) noexcept: coord_(coord) {}
+    //! Compute distances around the cells
+    void build(const Lattice& lattice, const CellStore& cells);
+    //! Check if build() should be called
+    bool is_stale(size_t num_cells) const noexcept {
+        return num_cells > 2u * built_size_ || holes_.size() > max_holes;
+    }
+    //! Lower bound of the graph distance from v to the nearest empty site;
+    //! holes filled since vacate() are forgotten
+    unsigned lower_bound(const coord_t& v, const Lattice& lattice);
+    //! Update distances around v, which has become empty
+    void vacate(const coord_t& v);
+    //! Number of sites in the bounding box
+    size_t capacity() const noexcept {return data_.size();}
+
+  private:
+    //! Set the index of v to i and return true if it is in the bounding box
+    bool find(const coord_t& v, size_t* i) const noexcept;
+    //! build() is called if #holes_ grows larger than this
+    static constexpr size_t max_holes = 64u;
+    //! Maximum number of sites updated by vacate()
+    static constexpr size_t max_relaxation = 256u;
+    //! Distance of occupied sites not reached yet
+    static constexpr uint16_t unknown = UINT16_MAX;
+
+    //! coordinate system of the lattice
+    const Coord& coord_;
+    //! distances in x-minor order, saturated at unknown - 1
+    std::vector<uint16_t> data_{};
+    //! index offsets of Coord::directions()
+    std::vector<std::ptrdiff_t> offsets_{};
+    //! lower corner of the bounding box
+    coord_t lower_{};
+    //! width of the bounding box; 1 for unused axes
+    std::array<unsigned, MAX_DIM> extent_{};
+    //! empty sites not propagated to #data_
+    std::vector<coord_t> holes_{};
+    //! reusable queue of breadth-first search
+    std::vector<size_t> frontier_{};
+    //! distances before vacate() in the same order as #frontier_
+    std::vector<uint16_t> previous_{};
+    //! number of cells at the last build()
+    size_t built_size_{0u};
+};
+
+} // namespace tumopp
+
+#endif // TUMOPP_SURFACE_HPP_
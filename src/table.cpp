@@ -0,0 +1,388 @@
+/*! @file table.cpp
+    @brief Implementation of TableWriter, TableReader, and TsvWriter classes
+*/
+#include "table.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace tumopp {
+
+namespace {
+
+//! magic number at the beginning of a file
+constexpr char magic[] = {'T', 'C', 'F', '1'};
+
+//! Append n lower bytes of bits in little-endian
+inline void put_le(std::string* out, uint64_t bits, size_t n) {
+    for (size_t i = 0u; i < n; ++i) {
+        out->push_back(static_cast<char>((bits >> (8u * i)) & 0xffu));
+    }
+}
+
+//! Read n bytes in little-endian
+inline uint64_t get_le(const char* in, size_t n) noexcept {
+    uint64_t bits = 0u;
+    for (size_t i = 0u; i < n; ++i) {
+        bits |= uint64_t{static_cast<unsigned char>(in[i])} << (8u * i);
+    }
+    return bits;
+}
+
+//! Read n bytes in little-endian from a file
+inline uint64_t read_le(std::istream& ist, size_t n) {
+    char buffer[8];
+    if (!ist.read(buffer, static_cast<std::streamsize>(n))) {
+        throw std::runtime_error("unexpected end of TCF");
+    }
+    return get_le(buffer, n);
+}
+
+//! Read n bytes from a file of size bytes; throw if it ends before
+inline void read_bytes(std::istream& ist, std::string* out, uint64_t n,
+                       uint64_t size, const std::string& path) {
+    const auto pos = static_cast<int64_t>(ist.tellg());
+    if (pos < 0 || n > size - static_cast<uint64_t>(pos)) {
+        throw std::runtime_error("unexpected end of TCF: " + path);
+    }
+    out->resize(n);
+    if (!ist.read(out->data(), static_cast<std::streamsize>(n))) {
+        throw std::runtime_error("unexpected end of TCF: " + path);
+    }
+}
+
+//! Upper bound of the compression ratio of zlib
+constexpr uint64_t max_ratio = 1032u;
+
+//! Size of a value; 0 if variable
+inline size_t width(Column::Type type) {
+    switch (type) {
+      case Column::Type::int8: return 1u;
+      case Column::Type::int32: return 4u;
+      case Column::Type::uint32: return 4u;
+      case Column::Type::float64: return 8u;
+      case Column::Type::string: return 0u;
+    }
+    throw std::runtime_error("unknown column type in TCF");
+}
+
+} // namespace
+
+const char* Column::type_name(Type type) {
+    switch (type) {
+      case Type::int8: return "int8";
+      case Type::int32: return "int32";
+      case Type::uint32: return "uint32";
+      case Type::float64: return "float64";
+      case Type::string: return "string";
+    }
+    return "unknown";
+}
+
+/////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+
+TableWriter::TableWriter(const std::string& path, const std::vector<Column>& columns,
+                         size_t group_rows):
+  ofs_(path, std::ios::binary),
+  path_(path),
+  columns_(columns),
+  buffers_(columns.size()),
+  group_rows_(group_rows) {
+    if (!ofs_) throw std::runtime_error("cannot open " + path);
+    std::string header(magic, sizeof(magic));
+    put_le(&header, columns_.size(), 4u);
+    for (const auto& column: columns_) {
+        put_le(&header, static_cast<uint8_t>(column.type), 1u);
+        put_le(&header, column.name.size(), 4u);
+        header.append(column.name);
+    }
+    ofs_.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+TableWriter::~TableWriter() {
+    if (!ofs_.is_open()) return;
+    try {
+        close();
+    } catch (...) {
+        // destructors must not throw; call close() to catch errors
+    }
+}
+
+std::string* TableWriter::next(Column::Type type) {
+    if (columns_[column_].type != type) {
+        throw std::logic_error(std::string("TCF column ") + columns_[column_].name
+                               + " is " + Column::type_name(columns_[column_].type)
+                               + ", not " + Column::type_name(type));
+    }
+    return &buffers_[column_];
+}
+
+void TableWriter::advance() {
+    if (++column_ < columns_.size()) return;
+    column_ = 0u;
+    if (++rows_ == group_rows_) write_group();
+}
+
+TableWriter& TableWriter::operator<<(int8_t value) {
+    put_le(next(Column::Type::int8), static_cast<uint8_t>(value), 1u);
+    advance();
+    return *this;
+}
+
+TableWriter& TableWriter::operator<<(int32_t value) {
+    put_le(next(Column::Type::int32), static_cast<uint32_t>(value), 4u);
+    advance();
+    return *this;
+}
+
+TableWriter& TableWriter::operator<<(uint32_t value) {
+    put_le(next(Column::Type::uint32), value, 4u);
+    advance();
+    return *this;
+}
+
+TableWriter& TableWriter::operator<<(double value) {
+    uint64_t bits = 0u;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_le(next(Column::Type::float64), bits, 8u);
+    advance();
+    return *this;
+}
+
+TableWriter& TableWriter::operator<<(const std::string& value) {
+    std::string* buffer = next(Column::Type::string);
+    put_le(buffer, value.size(), 4u);
+    buffer->append(value);
+    advance();
+    return *this;
+}
+
+void TableWriter::write_group() {
+    if (rows_ == 0u) return;
+    std::string group;
+    put_le(&group, rows_, 4u);
+    std::string compressed;
+    for (auto& buffer: buffers_) {
+        uLongf zsize = compressBound(static_cast<uLong>(buffer.size()));
+        compressed.resize(zsize);
+        const int status = compress2(
+          reinterpret_cast<Bytef*>(compressed.data()), &zsize,
+          reinterpret_cast<const Bytef*>(buffer.data()), static_cast<uLong>(buffer.size()),
+          Z_DEFAULT_COMPRESSION);
+        if (status != Z_OK) throw std::runtime_error("compress2() failed for " + path_);
+        put_le(&group, buffer.size(), 8u);
+        put_le(&group, zsize, 8u);
+        group.append(compressed.data(), zsize);
+        buffer.clear();
+    }
+    ofs_.write(group.data(), static_cast<std::streamsize>(group.size()));
+    rows_ = 0u;
+}
+
+void TableWriter::close() {
+    if (column_ != 0u) throw std::logic_error("incomplete row in " + path_);
+    write_group();
+    std::string end;
+    put_le(&end, 0u, 4u);
+    ofs_.write(end.data(), static_cast<std::streamsize>(end.size()));
+    ofs_.close();
+    if (!ofs_) throw std::runtime_error("failed to write " + path_);
+}
+
+/////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+
+TableReader::TableReader(const std::string& path):
+  ifs_(path, std::ios::binary),
+  path_(path) {
+    if (!ifs_) throw std::runtime_error("cannot open " + path);
+    ifs_.seekg(0, std::ios::end);
+    size_ = static_cast<uint64_t>(ifs_.tellg());
+    ifs_.seekg(0, std::ios::beg);
+    char buffer[sizeof(magic)];
+    if (!ifs_.read(buffer, sizeof(magic)) || std::memcmp(buffer, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("not a TCF file: " + path);
+    }
+    const auto ncols = read_le(ifs_, 4u);
+    for (uint64_t j = 0u; j < ncols; ++j) {
+        const auto type = static_cast<Column::Type>(read_le(ifs_, 1u));
+        width(type);  // validate
+        std::string name;
+        read_bytes(ifs_, &name, read_le(ifs_, 4u), size_, path);
+        columns_.push_back(Column{std::move(name), type});
+    }
+    buffers_.resize(columns_.size());
+    offsets_.resize(columns_.size());
+}
+
+bool TableReader::next() {
+    rows_ = 0u;  // no rows are available if broken
+    const size_t rows = read_le(ifs_, 4u);
+    if (rows == 0u) return false;
+    std::string compressed;
+    for (size_t j = 0u; j < columns_.size(); ++j) {
+        auto& buffer = buffers_[j];
+        const size_t w = width(columns_[j].type);
+        const uint64_t raw = read_le(ifs_, 8u);
+        read_bytes(ifs_, &compressed, read_le(ifs_, 8u), size_, path_);
+        if ((w > 0u && raw != w * rows) || (w == 0u && raw < 4u * rows)
+            || raw > max_ratio * compressed.size()) {
+            throw std::runtime_error("broken row group in " + path_);
+        }
+        buffer.resize(raw);
+        auto size = static_cast<uLongf>(buffer.size());
+        const int status = uncompress(
+          reinterpret_cast<Bytef*>(buffer.data()), &size,
+          reinterpret_cast<const Bytef*>(compressed.data()),
+          static_cast<uLong>(compressed.size()));
+        if (status != Z_OK || size != buffer.size()) {
+            throw std::runtime_error("broken row group in " + path_);
+        }
+        auto& offsets = offsets_[j];
+        offsets.clear();
+        if (w > 0u) continue;
+        size_t pos = 0u;
+        while (offsets.size() < rows) {
+            if (4u > buffer.size() - pos
+                || get_le(buffer.data() + pos, 4u) > buffer.size() - pos - 4u) {
+                throw std::runtime_error("broken row group in " + path_);
+            }
+            offsets.push_back(pos);
+            pos += 4u + get_le(buffer.data() + pos, 4u);
+        }
+        if (pos != buffer.size()) throw std::runtime_error("broken row group in " + path_);
+    }
+    rows_ = rows;
+    return true;
+}
+
+template <> int8_t TableReader::get<int8_t>(size_t column, size_t row) const {
+    return static_cast<int8_t>(get_le(buffers_[column].data() + row, 1u));
+}
+
+template <> int32_t TableReader::get<int32_t>(size_t column, size_t row) const {
+    return static_cast<int32_t>(get_le(buffers_[column].data() + 4u * row, 4u));
+}
+
+template <> uint32_t TableReader::get<uint32_t>(size_t column, size_t row) const {
+    return static_cast<uint32_t>(get_le(buffers_[column].data() + 4u * row, 4u));
+}
+
+template <> double TableReader::get<double>(size_t column, size_t row) const {
+    const uint64_t bits = get_le(buffers_[column].data() + 8u * row, 8u);
+    double value = 0.0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string TableReader::get_string(size_t column, size_t row) const {
+    const char* p = buffers_[column].data() + offsets_[column][row];
+    return std::string(p + 4u, get_le(p, 4u));
+}
+
+std::ostream& TableReader::write_header(std::ostream& ost) const {
+    const char* delimiter = "";
+    for (const auto& column: columns_) {
+        ost << delimiter << column.name;
+        delimiter = "\t";
+    }
+    return ost << "\n";
+}
+
+std::ostream& TableReader::write(std::ostream& ost) const {
+    TsvWriter tsv(ost);
+    for (size_t i = 0u; i < rows_; ++i) {
+        for (size_t j = 0u; j < columns_.size(); ++j) {
+            if (j > 0u) tsv << '\t';
+            switch (columns_[j].type) {
+              case Column::Type::int8: tsv << static_cast<int>(get<int8_t>(j, i)); break;
+              case Column::Type::int32: tsv << static_cast<int>(get<int32_t>(j, i)); break;
+              case Column::Type::uint32: tsv << static_cast<unsigned>(get<uint32_t>(j, i)); break;
+              case Column::Type::float64: tsv << get<double>(j, i); break;
+              case Column::Type::string: tsv << get_string(j, i); break;
+            }
+        }
+        tsv << '\n';
+    }
+    tsv.flush();
+    return ost;
+}
+
+/////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
+
+TsvWriter::TsvWriter(std::ostream& ost, size_t block):
+  ost_(ost),
+  precision_(static_cast<int>(ost.precision())),
+  buffer_(std::max<size_t>(block, 64u)) {}
+
+TsvWriter::~TsvWriter() {
+    if (size_ == 0u) return;
+    try {
+        flush();
+    } catch (...) {
+        // destructors must not throw; call flush() to catch errors
+    }
+}
+
+TsvWriter& TsvWriter::operator<<(const int value) {
+    char* first = reserve(16u);
+    size_ += static_cast<size_t>(std::to_chars(first, first + 16u, value).ptr - first);
+    return *this;
+}
+
+TsvWriter& TsvWriter::operator<<(const unsigned value) {
+    char* first = reserve(16u);
+    size_ += static_cast<size_t>(std::to_chars(first, first + 16u, value).ptr - first);
+    return *this;
+}
+
+TsvWriter& TsvWriter::operator<<(const double value) {
+    // as printf("%.*g"), which std::ostream uses in the default floatfield
+    constexpr size_t n = 64u;
+    char* first = reserve(n);
+#ifdef TUMOPP_NO_TO_CHARS_DOUBLE
+    const int length = std::snprintf(first, n, "%.*g", precision_, value);
+    if (length < 0 || static_cast<size_t>(length) >= n) {
+        throw std::runtime_error("too large precision for TsvWriter");
+    }
+    size_ += static_cast<size_t>(length);
+#else
+    const auto result = std::to_chars(first, first + n, value, std::chars_format::general, precision_);
+    if (result.ec != std::errc{}) throw std::runtime_error("too large precision for TsvWriter");
+    size_ += static_cast<size_t>(result.ptr - first);
+#endif
+    return *this;
+}
+
+TsvWriter& TsvWriter::operator<<(const std::string& s) {
+    append(s.data(), s.size());
+    return *this;
+}
+
+TsvWriter& TsvWriter::operator<<(const char* s) {
+    append(s, std::strlen(s));
+    return *this;
+}
+
+void TsvWriter::append(const char* s, size_t n) {
+    if (n > buffer_.size()) {
+        flush();
+        ost_.write(s, static_cast<std::streamsize>(n));
+        return;
+    }
+    std::memcpy(reserve(n), s, n);
+    size_ += n;
+}
+
+void TsvWriter::flush() {
+    ost_.write(buffer_.data(), static_cast<std::streamsize>(size_));
+    size_ = 0u;
+}
+
+} // namespace tumopp
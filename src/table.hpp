@@ -0,0 +1,198 @@
+/*! @file table.hpp
+    @brief Interface of TableWriter, TableReader, and TsvWriter classes
+*/
+#pragma once
+#ifndef TUMOPP_TABLE_HPP_
+#define TUMOPP_TABLE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace tumopp {
+
+/*! @brief Type and name of a column in TCF
+
+    TCF (tumopp columnar format) is a self-describing binary table.
+    All numbers are little-endian:
+
+        file   := "TCF1" ncols:u32 column{ncols} group* 0:u32
+        column := type:u8 length:u32 name
+        group  := nrows:u32 (size:u64 zsize:u64 zlib-compressed bytes){ncols}
+
+    Each column of a row group is compressed separately;
+    string values are stored as length:u32 followed by the bytes.
+*/
+struct Column {
+    //! Type of values
+    enum class Type: uint8_t {int8 = 1u, int32, uint32, float64, string};
+    //! name in the header
+    std::string name;
+    //! type of values
+    Type type;
+    //! Name of the type
+    static const char* type_name(Type type);
+};
+
+/*! @brief Writer of TCF files row by row
+
+    Values are appended with operator<<() in the order of columns,
+    and their types must match the columns.
+    Rows are compressed in groups of a fixed number of rows.
+*/
+class TableWriter {
+  public:
+    //! Constructor: write the header
+    TableWriter(const std::string& path, const std::vector<Column>& columns,
+                size_t group_rows = 1u << 16u);
+    //! Destructor: close() if not closed; errors are ignored
+    ~TableWriter();
+    TableWriter(const TableWriter&) = delete;
+    TableWriter& operator=(const TableWriter&) = delete;
+
+    //! Append a value to the current row
+    TableWriter& operator<<(int8_t value);
+    //! Append a value to the current row
+    TableWriter& operator<<(int32_t value);
+    //! Append a value to the current row
+    TableWriter& operator<<(uint32_t value);
+    //! Append a value to the current row
+    TableWriter& operator<<(double value);
+    //! Append a value to the current row
+    TableWriter& operator<<(const std::string& value);
+    //! Write the last group and the end mark; throw std::runtime_error on failure
+    void close();
+
+  private:
+    //! Check the type of the next column and return its buffer
+    std::string* next(Column::Type type);
+    //! Move to the next column; write_group() if enough rows are complete
+    void advance();
+    //! Compress and write the buffered rows
+    void write_group();
+
+    //! output file
+    std::ofstream ofs_;
+    //! path of #ofs_
+    std::string path_;
+    //! schema
+    std::vector<Column> columns_;
+    //! raw bytes of buffered rows of each column
+    std::vector<std::string> buffers_;
+    //! number of rows in a group
+    size_t group_rows_;
+    //! number of buffered rows
+    size_t rows_{0u};
+    //! index of the next column in the current row
+    size_t column_{0u};
+};
+
+/*! @brief Reader of TCF files group by group
+*/
+class TableReader {
+  public:
+    //! Constructor: read the header
+    explicit TableReader(const std::string& path);
+    //! Get schema
+    const std::vector<Column>& columns() const noexcept {return columns_;}
+    //! Read the next row group; false at the end of the file
+    bool next();
+    //! Number of rows in the current group
+    size_t rows() const noexcept {return rows_;}
+    //! Get a number in the current group
+    template <class T>
+    T get(size_t column, size_t row) const;
+    //! Get a string in the current group
+    std::string get_string(size_t column, size_t row) const;
+    //! Write the header in TSV
+    std::ostream& write_header(std::ostream&) const;
+    //! Write the current group in TSV
+    std::ostream& write(std::ostream&) const;
+
+  private:
+    //! input file
+    std::ifstream ifs_;
+    //! path of #ifs_
+    std::string path_;
+    //! size of #ifs_ in bytes
+    uint64_t size_{0u};
+    //! schema
+    std::vector<Column> columns_;
+    //! decompressed bytes of each column in the current group
+    std::vector<std::string> buffers_;
+    //! byte offsets of rows in each string column
+    std::vector<std::vector<size_t>> offsets_;
+    //! number of rows in the current group
+    size_t rows_{0u};
+};
+
+/*! @brief Writer of TSV into blocks of a contiguous buffer
+
+    Numbers are formatted with std::to_chars,
+    which gives the same text as std::ostream in the default floatfield
+    with the precision of the destination, regardless of its locale.
+    If the standard library lacks std::to_chars for double,
+    e.g., libc++ before macOS 13.3 and libstdc++ before g++ 11,
+    CMake defines TUMOPP_NO_TO_CHARS_DOUBLE to use `snprintf("%.*g")` instead,
+    which follows the C locale.
+    The buffer is written to the destination in blocks,
+    which is much faster than many small insertions into a zlib stream.
+*/
+class TsvWriter {
+  public:
+    //! Constructor: take the precision of ost
+    explicit TsvWriter(std::ostream& ost, size_t block = 1u << 20u);
+    //! Destructor: flush() if not flushed; errors are ignored
+    ~TsvWriter();
+    TsvWriter(const TsvWriter&) = delete;
+    TsvWriter& operator=(const TsvWriter&) = delete;
+
+    //! Append a number
+    TsvWriter& operator<<(int value);
+    //! Append a number
+    TsvWriter& operator<<(unsigned value);
+    //! Append a number
+    TsvWriter& operator<<(double value);
+    //! Append a character
+    TsvWriter& operator<<(char c) {
+        if (size_ == buffer_.size()) flush();
+        buffer_[size_++] = c;
+        return *this;
+    }
+    //! Append a string
+    TsvWriter& operator<<(const std::string& s);
+    //! Append a string
+    TsvWriter& operator<<(const char* s);
+    //! Write the buffer to the destination
+    void flush();
+
+  private:
+    //! Append n characters
+    void append(const char* s, size_t n);
+    //! Make room for n characters
+    char* reserve(size_t n) {
+        if (size_ + n > buffer_.size()) flush();
+        return buffer_.data() + size_;
+    }
+
+    //! destination
+    std::ostream& ost_;
+    //! precision of #ost_
+    int precision_;
+    //! block of characters
+    std::vector<char> buffer_;
+    //! number of characters in #buffer_
+    size_t size_{0u};
+};
+
+template <> int8_t TableReader::get<int8_t>(size_t, size_t) const;
+template <> int32_t TableReader::get<int32_t>(size_t, size_t) const;
+template <> uint32_t TableReader::get<uint32_t>(size_t, size_t) const;
+template <> double TableReader::get<double>(size_t, size_t) const;
+
+} // namespace tumopp
+
+#endif // TUMOPP_TABLE_HPP_
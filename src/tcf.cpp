@@ -0,0 +1,70 @@
+/*! @file tcf.cpp
+    @brief Defines main() of tumopp-tcf, a reader of `--format tcf`
+*/
+#include "table.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+//! Print usage
+inline void usage(std::ostream& ost) {
+    ost << "Usage: tumopp-tcf [-s] FILE.tcf ...\n\n"
+           "Convert TCF files of tumopp to TSV in the standard output;\n"
+           "the same as the files written with --format tsv after decompression.\n\n"
+           "  -s  Print columns and row groups instead\n"
+           "  -h  Print this help\n";
+}
+
+//! Print columns and the number of rows in each group
+inline void schema(tumopp::TableReader& reader, std::ostream& ost) {
+    for (const auto& column: reader.columns()) {
+        ost << column.name << "\t" << tumopp::Column::type_name(column.type) << "\n";
+    }
+    size_t groups = 0u;
+    size_t rows = 0u;
+    while (reader.next()) {
+        ++groups;
+        rows += reader.rows();
+    }
+    ost << "# " << rows << " rows in " << groups << " groups\n";
+}
+
+//! Convert files in arguments
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+    std::cout.precision(9);  // the same as tumopp
+    std::vector<std::string> paths;
+    bool print_schema = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            usage(std::cout);
+            return 0;
+        }
+        if (arg == "-s") {
+            print_schema = true;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        usage(std::cerr);
+        return 1;
+    }
+    try {
+        for (const auto& path: paths) {
+            tumopp::TableReader reader(path);
+            if (print_schema) {
+                schema(reader, std::cout);
+                continue;
+            }
+            reader.write_header(std::cout);
+            while (reader.next()) reader.write(std::cout);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
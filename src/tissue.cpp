@@ -8,6 +8,14 @@
 #include <wtl/iostr.hpp>
 #include <wtl/numeric.hpp>
 #include <wtl/algorithm.hpp>
+#include <wtl/zlib.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <thread>
 
 namespace tumopp {
 
@@ -17,50 +25,77 @@ Tissue::Tissue(
   const std::string& coordinate,
   const std::string& local_density_effect,
   const std::string& displacement_path,
+  const std::string& lattice,
+  const std::string& queue,
   const EventRates& init_event_rates,
+  const CellParams& cell_params,
   const uint32_t seed,
   const bool verbose,
-  const bool enable_benchmark):
+  const bool enable_benchmark,
+  const bool prune,
+  const std::string& engine,
+  const unsigned threads):
+  prune_(prune),
   engine_(std::make_unique<urbg_t>(seed)),
   verbose_(verbose) {
     if (enable_benchmark) {
         benchmark_ = std::make_unique<Benchmark>();
         benchmark_->append(0u);
     }
-    snapshots_.precision(std::cout.precision());
     drivers_.precision(std::cout.precision());
-    init_coord(dimensions, coordinate);
-    init_insert_function(local_density_effect, displacement_path);
+    cells_.param(cell_params);
+    init_lattice(dimensions, lattice);
+    init_queue(queue);
+    init_engine(engine, threads);
+    init_coord(dimensions, coordinate, local_density_effect, displacement_path);
     const auto initial_coords = coord_func_->sphere(initial_size);
-    const auto origin = std::make_shared<Cell>(
+    const uint32_t first = cells_.emplace(
       initial_coords[0], ++id_tail_,
-      std::make_shared<EventRates>(init_event_rates)
-    );
-    extant_cells_.insert(origin);
-    while (extant_cells_.size() < initial_size) {
-        for (const auto& mother: extant_cells_) {
-            const auto daughter = std::make_shared<Cell>(*mother);
-            const auto ancestor = std::make_shared<Cell>(*mother);
-            ancestor->set_time_of_death(0.0);
-            mother->set_time_of_birth(0.0, ++id_tail_, ancestor);
-            daughter->set_time_of_birth(0.0, ++id_tail_, ancestor);
-            daughter->set_coord(initial_coords[extant_cells_.size()]);
-            extant_cells_.insert(daughter);
-            if (extant_cells_.size() >= initial_size) break;
-        }
-    }
-    for (const auto& cell: extant_cells_) queue_push(cell);
-}
-
-Tissue::~Tissue() = default;
-
-void Tissue::init_coord(const unsigned dimensions, const std::string& coordinate) {
-    std::unordered_map<std::string, std::unique_ptr<Coord>> swtch;
-    swtch["neumann"] = std::make_unique<Neumann>(dimensions);
-    swtch["moore"] = std::make_unique<Moore>(dimensions);
-    swtch["hex"] = std::make_unique<Hexagonal>(dimensions);
+      init_event_rates);
+    dormant_.resize(first + 1u, 0u);
+    emplace(first);
+    while (size() < initial_size) {
+        for (uint32_t i = 1u, n = static_cast<uint32_t>(cells_.slots()); i < n; ++i) {
+            const uint32_t daughter = allocate(i);
+            const uint32_t ancestor = genealogy_.append(cells_, i, 0.0);
+            cells_.set_time_of_birth(i, 0.0, ++id_tail_, ancestor);
+            cells_.set_time_of_birth(daughter, 0.0, ++id_tail_, ancestor);
+            cells_.set_coord(daughter, initial_coords[size() - 1u]);
+            emplace(daughter);
+            if (size() >= initial_size) break;
+        }
+    }
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) queue_push(i);
+}
+
+Tissue::~Tissue() {
+    if (!streams_history()) return;
+    history_.reset();
+    history_table_.reset();
+    std::error_code ec;
+    std::filesystem::remove(history_path_, ec);
+}
+
+void Tissue::init_coord(const unsigned dimensions, const std::string& coordinate,
+                        const std::string& local_density_effect, const std::string& displacement_path) {
+    if (dimensions < 1u || MAX_DIM < dimensions) {
+        throw std::runtime_error("Invalid value for dimensions");
+    }
+    // the only runtime dispatch on the coordinate system
+    using init_t = void (Tissue::*)(const std::string&, const std::string&);
+    std::unordered_map<std::string, std::array<init_t, MAX_DIM>> swtch;
+    swtch["neumann"] = {&Tissue::init_policy<Neumann<1u>>,
+                        &Tissue::init_policy<Neumann<2u>>,
+                        &Tissue::init_policy<Neumann<3u>>};
+    swtch["moore"] = {&Tissue::init_policy<Moore<1u>>,
+                      &Tissue::init_policy<Moore<2u>>,
+                      &Tissue::init_policy<Moore<3u>>};
+    swtch["hex"] = {&Tissue::init_policy<Hexagonal<1u>>,
+                    &Tissue::init_policy<Hexagonal<2u>>,
+                    &Tissue::init_policy<Hexagonal<3u>>};
+    init_t init = nullptr;
     try {
-        coord_func_ = std::move(swtch.at(coordinate));
+        init = swtch.at(coordinate)[dimensions - 1u];
     } catch (std::exception& e) {
         std::ostringstream oss;
         oss << "\n" << __FILE__ << ':' << __LINE__ << ':' << __PRETTY_FUNCTION__
@@ -68,20 +103,85 @@ void Tissue::init_coord(const unsigned dimensions, const std::string& coordinate
             << wtl::keys(swtch);
         throw std::runtime_error(oss.str());
     }
+    (this->*init)(local_density_effect, displacement_path);
+}
+
+template <class C>
+void Tissue::init_policy(const std::string& local_density_effect, const std::string& displacement_path) {
+    coord_func_ = std::make_unique<C>();
+    adjacent_order_ = wtl::seq_len<unsigned>(C::table.size());
+    nearest_order_ = adjacent_order_;
+    init_grow_impl<C>(local_density_effect, displacement_path);
+}
+
+void Tissue::init_lattice(const unsigned dimensions, const std::string& lattice) {
+    std::unordered_map<std::string, std::unique_ptr<Lattice>> swtch;
+    swtch["dense"] = std::make_unique<DenseLattice>(dimensions);
+    swtch["brick"] = std::make_unique<BrickLattice>(dimensions);
+    swtch["hash"] = std::make_unique<HashLattice>(dimensions);
+    try {
+        lattice_ = std::move(swtch.at(lattice));
+    } catch (std::exception& e) {
+        std::ostringstream oss;
+        oss << "\n" << __FILE__ << ':' << __LINE__ << ':' << __PRETTY_FUNCTION__
+            << "\nInvalid value for --lattice (" << lattice << "); choose from "
+            << wtl::keys(swtch);
+        throw std::runtime_error(oss.str());
+    }
+}
+
+void Tissue::init_queue(const std::string& queue) {
+    std::unordered_map<std::string, std::unique_ptr<EventQueue>> swtch;
+    swtch["multimap"] = std::make_unique<MultimapQueue>();
+    swtch["heap"] = std::make_unique<HeapQueue>();
+    swtch["calendar"] = std::make_unique<CalendarQueue>();
+    try {
+        queue_ = std::move(swtch.at(queue));
+    } catch (std::exception& e) {
+        std::ostringstream oss;
+        oss << "\n" << __FILE__ << ':' << __LINE__ << ':' << __PRETTY_FUNCTION__
+            << "\nInvalid value for --queue (" << queue << "); choose from "
+            << wtl::keys(swtch);
+        throw std::runtime_error(oss.str());
+    }
+}
+
+void Tissue::init_engine(const std::string& engine, const unsigned threads) {
+    std::unordered_map<std::string, unsigned> swtch;
+    swtch["serial"] = 0u;
+    swtch["conservative"] = std::max(threads, 1u);
+    try {
+        num_domains_ = swtch.at(engine);
+    } catch (std::exception& e) {
+        std::ostringstream oss;
+        oss << "\n" << __FILE__ << ':' << __LINE__ << ':' << __PRETTY_FUNCTION__
+            << "\nInvalid value for --engine (" << engine << "); choose from "
+            << wtl::keys(swtch);
+        throw std::runtime_error(oss.str());
+    }
 }
 
 bool Tissue::grow(const size_t max_size, const double max_time,
                   const double snapshot_interval,
                   size_t recording_early_growth,
                   size_t mutation_timing) {
+    return (this->*grow_impl_)(max_size, max_time, snapshot_interval,
+                               recording_early_growth, mutation_timing);
+}
+
+template <class C, Tissue::Density L, Tissue::Path P>
+bool Tissue::grow_impl(const size_t max_size, const double max_time,
+                       const double snapshot_interval,
+                       size_t recording_early_growth,
+                       size_t mutation_timing) {
     if (recording_early_growth > 0u) {snapshots_append();}
     bool success = false;
     double time_snapshot = snapshot_interval;
     constexpr size_t progress_interval{1 << 12};
-    while (true) {
-        auto it = queue_.begin();
-        time_ = it->first;
-        if (time_ > max_time || extant_cells_.size() >= max_size) {
+    while (!cancelled_.load(std::memory_order_relaxed)) {
+        const auto next = queue_->top();
+        time_ = next.first;
+        if (time_ > max_time || size() >= max_size) {
             success = true; // maybe not; but want to exit with record
             break;
         }
@@ -89,131 +189,618 @@ bool Tissue::grow(const size_t max_size, const double max_time,
             snapshots_append();
             time_snapshot = time_ + snapshot_interval;
         }
-        const auto mother = std::move(it->second);
-        queue_.erase(it);
-        if (mother->next_event() == Event::birth) {
-            const auto daughter = std::make_shared<Cell>(*mother);
-            if (insert(daughter)) {
-                const auto ancestor = std::make_shared<Cell>(*mother);
-                ancestor->set_time_of_death(time_);
-                mother->set_time_of_birth(time_, ++id_tail_, ancestor);
-                daughter->differentiate(*engine_);
-                daughter->set_time_of_birth(time_, ++id_tail_, ancestor);
-                drivers_ << mother->mutate(*engine_);
-                drivers_ << daughter->mutate(*engine_);
-                if (extant_cells_.size() == mutation_timing) {
+        const uint32_t mother_handle = next.second;
+        queue_->pop();
+        if (dormant_[mother_handle]) {
+            dormant_[mother_handle] = 0u;
+            --num_dormant_;
+        }
+        const Event event = cells_.next_event(mother_handle);
+        if (event == Event::birth) {
+            const uint32_t daughter_handle = allocate(mother_handle);
+            if (insert<C, L, P>(daughter_handle)) {
+                const uint32_t ancestor = genealogy_.append(cells_, mother_handle, time_);
+                cells_.set_time_of_birth(mother_handle, time_, ++id_tail_, ancestor);
+                cells_.differentiate(daughter_handle, *engine_);
+                cells_.set_time_of_birth(daughter_handle, time_, ++id_tail_, ancestor);
+                drivers_ << cells_.mutate(mother_handle, *engine_);
+                drivers_ << cells_.mutate(daughter_handle, *engine_);
+                if (size() == mutation_timing) {
                     mutation_timing = 0u; // once
-                    drivers_ << daughter->force_mutate(*engine_);
+                    drivers_ << cells_.force_mutate(daughter_handle, *engine_);
                 }
-                queue_push(mother);
-                queue_push(daughter);
-                const auto size = extant_cells_.size();
+                queue_push(mother_handle);
+                queue_push(daughter_handle);
+                if (genealogy_.size() > compact_threshold_) compact_history();
+                const auto size = this->size();
                 if ((size % progress_interval) == 0u) {
                     if (verbose_) std::cerr << "\r" << size;
                     if (benchmark_) benchmark_->append(size);
                 }
             } else {
-                queue_push(mother, true);
+                cells_.release(daughter_handle);
+                if (cells_.parkable()
+                    && num_empty_neighbors<C>(pack<C>(cells_.coord(mother_handle))) == 0U) {
+                    park(mother_handle);
+                } else {
+                    queue_push(mother_handle, true);
+                }
                 continue;  // skip write()
             }
-        } else if (mother->next_event() == Event::death) {
-            entomb(mother);
-            if (extant_cells_.empty()) break;
+        } else if (event == Event::death) {
+            entomb<C>(mother_handle);
+            if (size() == 0u) break;
+            if (prune_ && genealogy_.size() > prune_threshold_) prune();
+            if (genealogy_.size() > compact_threshold_) compact_history();
         } else {
-            migrate(mother);
-            queue_push(mother);
+            migrate<C>(mother_handle);
+            queue_push(mother_handle);
         }
-        if (extant_cells_.size() < recording_early_growth) {
+        if (size() < recording_early_growth) {
             snapshots_append();
         } else {
             recording_early_growth = 0u;  // prevent restart by cell death
         }
     }
-    if (verbose_) std::cerr << "\r" << extant_cells_.size() << std::endl;
+    if (prune_) prune();
+    if (verbose_) std::cerr << "\r" << size() << std::endl;
     return success;
 }
 
-void Tissue::plateau(const double time) {
-    queue_.clear();
-    for (auto& p: extant_cells_) {
-        p->increase_death_rate();
-        queue_push(p);
+template <class C, Tissue::Density L>
+bool Tissue::grow_domains(const size_t max_size, const double max_time,
+                          const double snapshot_interval,
+                          const size_t recording_early_growth,
+                          const size_t mutation_timing) {
+    if (snapshot_interval > 0.0 || recording_early_growth > 0u || mutation_timing > 0u) {
+        throw std::runtime_error("--engine conservative does not support -I, -R, or -U");
     }
-    grow(std::numeric_limits<size_t>::max(), time_ + time);
+    constexpr auto grow_serial = &Tissue::grow_impl<C, L, Path::mindrag>;
+    const size_t target = domain_events * num_domains_;
+    // boxes have no interior while the tumor is small
+    if (size() < target) {
+        const bool success = (this->*grow_serial)(std::min(max_size, target), max_time, 0.0, 0u, 0u);
+        if (!success || size() >= max_size || queue_->top().first > max_time) return success;
+    }
+    domains_.resize(num_domains_ + 1u);
+    for (auto& d: domains_) {
+        d.adjacent_order = adjacent_order_;
+        d.drivers.precision(drivers_.precision());
+    }
+    domains_.back().serial = true;
+    schedule_.assign(cells_.slots(), -1.0);
+    while (!queue_->empty()) {
+        const auto next = queue_->top();
+        queue_->pop();
+        schedule_[next.second] = next.first;
+        domains_.back().heap.push_back(next);
+    }
+    partition();
+    size_t partitioned = size();
+    size_t events = target;
+    double delta = static_cast<double>(target) / static_cast<double>(size());
+    bool success = false;
+    while (!cancelled_.load(std::memory_order_relaxed)) {
+        if (size() == 0u) break;
+        double start = std::numeric_limits<double>::infinity();
+        for (auto& d: domains_) {
+            while (!d.heap.empty() && schedule_[d.heap.front().second] != d.heap.front().first) d.pop();
+            if (!d.heap.empty()) start = std::min(start, d.heap.front().first);
+        }
+        if (start > max_time || size() >= max_size) {
+            time_ = start;
+            success = true;
+            break;
+        }
+        if (max_size - size() < events || start + delta > max_time) {
+            // the last window is processed serially to stop at max_size or max_time
+            gather_domains();
+            return (this->*grow_serial)(max_size, max_time, 0.0, 0u, 0u);
+        }
+        const double end = start + delta;
+        reserve_domains(2u * events);
+        for (auto& d: domains_) {
+            d.engine = urbg_t((*engine_)());
+            d.events = 0u;
+        }
+        // boxes must not pass an event of the boundary nearby, or one deferred by themselves
+        const int width = Fence::width(domain_reach);
+        fence_.cover(dense_->lower(), dense_->extent(), width);
+        fence_.start(start);
+        fence_heap(domains_.back().heap, end);
+        for (unsigned k = 0u; k < num_domains_; ++k) {
+            domains_[k].fence.cover(dense_->lower(), dense_->extent(), width);
+            domains_[k].fence.start(start);
+        }
+        std::vector<std::thread> threads;
+        threads.reserve(num_domains_ - 1u);
+        for (unsigned k = 1u; k < num_domains_; ++k) {
+            threads.emplace_back([this, k, end] {run_domain<C, L>(domains_[k], end);});
+        }
+        run_domain<C, L>(domains_[0], end);
+        for (auto& thread: threads) thread.join();
+        release_domains();
+        ++parallel_windows_;
+        run_serial<C, L>(end);
+        merge_domain(domains_.back());
+        time_ = end;
+        events = 0u;
+        for (const auto& d: domains_) events += d.events;
+        const size_t serial_events = domains_.back().events;
+        size_t goal = target;
+        if (serial_events * num_domains_ > events - serial_events) {
+            // the serial part outweighs a box; shorter windows defer fewer events
+            goal = std::max(events / 2u, domain_min_events * num_domains_);
+        }
+        delta *= std::clamp(static_cast<double>(goal) / static_cast<double>(std::max(events, size_t{1u})), 0.5, 2.0);
+        if (prune_ && genealogy_.size() > prune_threshold_) prune();
+        if (genealogy_.size() > compact_threshold_) compact_history();
+        if (verbose_) std::cerr << "\r" << size();
+        if (benchmark_) benchmark_->append(size());
+        if (size() > partitioned + partitioned / 4u) {
+            partition();
+            partitioned = size();
+        }
+    }
+    gather_domains();
+    if (prune_) prune();
+    if (verbose_) std::cerr << "\r" << size() << std::endl;
+    return success;
 }
 
-void Tissue::treatment(const double death_prob, const size_t num_resistant_cells) {
-    const size_t original_size = extant_cells_.size();
-    std::vector<std::shared_ptr<Cell>> cells;
-    cells.reserve(original_size);
-    for (const auto& p: queue_) { // for reproducibility
-        cells.emplace_back(p.second);
+template <class C, Tissue::Density L>
+void Tissue::run_domain(Domain& d, const double end) {
+    try {
+        while (!d.heap.empty() && d.heap.front().first < end) {
+            const auto next = d.pop();
+            const uint32_t x = next.second;
+            if (schedule_[x] != next.first) continue;  // rescheduled or dead
+            const auto& v = cells_.coord(x);
+            if (fence_.at(v) < next.first || d.fence.at(v) < next.first || !domain_ready<C>(d, x)) {
+                domain_defer(d, next.first, x);
+                continue;
+            }
+            d.time = next.first;
+            ++d.events;
+            domain_event<C, L>(d, x);
+        }
+    } catch (...) {
+        d.error = std::current_exception();
     }
-    std::shuffle(cells.begin(), cells.end(), *engine_);
-    for (size_t i=0; i<original_size; ++i) {
-        const auto& p = cells[i];
-        if (i >= num_resistant_cells) {
-            p->set_cycle_dependent_death(*engine_, death_prob);
+}
+
+template <class C, Tissue::Density L>
+void Tissue::run_serial(const double end) {
+    auto& serial = domains_.back();
+    while (true) {
+        Domain* earliest = nullptr;
+        for (auto& d: domains_) {
+            while (!d.heap.empty() && schedule_[d.heap.front().second] != d.heap.front().first) d.pop();
+            if (d.heap.empty()) continue;
+            if (!earliest || d.heap.front().first < earliest->heap.front().first) earliest = &d;
         }
+        if (!earliest || earliest->heap.front().first >= end) break;
+        const auto next = earliest->pop();
+        serial.time = next.first;
+        ++serial.events;
+        domain_event<C, L>(serial, next.second);
     }
 }
 
-void Tissue::queue_push(const std::shared_ptr<Cell>& x, const bool surrounded) {
-    double dt = x->delta_time(*engine_, time_, positional_value(x->coord()), surrounded);
-    queue_.emplace_hint(queue_.end(), dt += time_, x);
+void Tissue::fence_heap(const std::vector<Domain::event_type>& heap, const double end) {
+    // only subtrees of the min-heap rooted earlier than end are visited
+    std::vector<size_t> stack;
+    if (!heap.empty()) stack.push_back(0u);
+    while (!stack.empty()) {
+        const size_t i = stack.back();
+        stack.pop_back();
+        const auto& e = heap[i];
+        if (e.first >= end) continue;
+        if (schedule_[e.second] == e.first) fence_.insert(cells_.coord(e.second), e.first);
+        for (size_t child = 2u * i + 1u; child < std::min(2u * i + 3u, heap.size()); ++child) {
+            stack.push_back(child);
+        }
+    }
 }
 
-void Tissue::init_insert_function(const std::string& local_density_effect, const std::string& displacement_path) {
-    using func_t = std::function<bool(const std::shared_ptr<Cell>&)>;
-    using map_sf = std::unordered_map<std::string, func_t>;
-    std::unordered_map<std::string, map_sf> swtch;
+template <class C>
+bool Tissue::domain_ready(Domain& d, const uint32_t x) {
+    const auto& v = cells_.coord(x);
+    if (!d.contains(v)) return false;
+    coord_t lower = v;
+    coord_t upper = v;
+    for (unsigned j = 0u; j < C::num_dimensions; ++j) {
+        lower[j] -= domain_reach;
+        upper[j] += domain_reach;
+    }
+    // writes within the allocated box never reallocate the lattice
+    if (!dense_->is_allocated(pack<C>(lower)) || !dense_->is_allocated(pack<C>(upper))) return false;
+    // a birth takes a handle, a record, and two IDs and clones at most
+    if (d.handle == d.handle_end || d.record >= d.record_end) return false;
+    return !cells_.mutates() || d.shard.next_clone + d.shard.stride < d.shard.end_clone;
+}
 
-    swtch["const"].emplace("random", [this](const std::shared_ptr<Cell>& daughter) {
-        push(daughter, coord_func_->random_direction(*engine_));
-        return true;
-    });
-    swtch["const"].emplace("mindrag", [this](const std::shared_ptr<Cell>& daughter) {
-        push_minimum_drag(daughter);
-        return true;
-    });
-    swtch["const"].emplace("minstraight", [this](const std::shared_ptr<Cell>& daughter) {
-        push(daughter, to_nearest_empty(daughter->coord()));
-        return true;
-    });
-    swtch["const"].emplace("roulette", [this](const std::shared_ptr<Cell>& daughter) {
-        push(daughter, roulette_direction(daughter->coord()));
-        return true;
-    });
-    swtch["const"].emplace("stroll", [this](const std::shared_ptr<Cell>& daughter) {
-        stroll(daughter, coord_func_->random_direction(*engine_));
-        return true;
-    });
-    swtch["step"].emplace("random", [this](const std::shared_ptr<Cell>& daughter) {
-        if (num_empty_neighbors(daughter->coord()) == 0U) {return false;}
-        push(daughter, coord_func_->random_direction(*engine_));
-        return true;
-    });
-    swtch["step"].emplace("mindrag", [this](const std::shared_ptr<Cell>& daughter) {
-        return insert_adjacent(daughter);
-    });
-    swtch["linear"].emplace("random", [this](const std::shared_ptr<Cell>& daughter) {
-        const auto x = num_empty_neighbors(daughter->coord());
-        if (x > 0U) {
-            double prob = x;
-            prob /= coord_func_->directions().size();
-            if (wtl::generate_canonical(*engine_) < prob) {
-                push(daughter, coord_func_->random_direction(*engine_));
-                return true;
+template <class C, Tissue::Density L>
+void Tissue::domain_event(Domain& d, const uint32_t x) {
+    if (dormant_[x]) {
+        dormant_[x] = 0u;
+        --d.dormant;
+    }
+    const Event event = cells_.next_event(x);
+    if (event == Event::birth) {
+        const coord_t v = cells_.coord(x);
+        coord_t site{};
+        bool found = false;
+        if constexpr (L == Density::step) {
+            std::shuffle(d.adjacent_order.begin(), d.adjacent_order.end(), d.engine);
+            for (const auto i: d.adjacent_order) {
+                site = v + C::table[i];
+                if (lattice_->get(site) == Lattice::empty) {
+                    found = true;
+                    break;
+                }
+            }
+        } else {
+            site = v + random_direction<C>(d.engine);
+            found = (lattice_->get(site) == Lattice::empty);
+        }
+        if (!found) {
+            if (cells_.parkable() && num_empty_neighbors<C>(pack<C>(v)) == 0U) {
+                domain_park(d, x);
+            } else {
+                domain_schedule(d, x, true);
+            }
+            return;
+        }
+        uint32_t daughter = 0u;
+        CellStore::Shard* shard = nullptr;
+        if (d.serial) {
+            daughter = allocate(x);
+            if (daughter >= schedule_.size()) schedule_.resize(daughter + 1u, -1.0);
+        } else {
+            shard = &d.shard;
+            daughter = reserved_[d.handle++];
+            cells_.clone_at(x, daughter, shard);
+        }
+        cells_.set_coord(daughter, site);
+        lattice_->set(site, daughter);
+        const uint32_t ancestor = domain_record(d, x);
+        cells_.set_time_of_birth(x, d.time, domain_id(d), ancestor);
+        cells_.differentiate(daughter, d.engine);
+        cells_.set_time_of_birth(daughter, d.time, domain_id(d), ancestor);
+        d.drivers << cells_.mutate(x, d.engine, shard);
+        d.drivers << cells_.mutate(daughter, d.engine, shard);
+        domain_schedule(d, x);
+        domain_schedule(d, daughter);
+    } else if (event == Event::death) {
+        domain_record(d, x);
+        const auto v = cells_.coord(x);
+        lattice_->erase(v);
+        schedule_[x] = -1.0;
+        if (d.serial) {
+            cells_.release(x);
+        } else {
+            d.dead.push_back(x);
+        }
+        domain_wake_neighbors<C>(d, pack<C>(v));
+    } else {
+        const auto orig_pos = cells_.coord(x);
+        cells_.add_coord(x, random_direction<C>(d.engine));
+        const uint32_t existing = lattice_->exchange(cells_.coord(x), x);
+        lattice_->set(orig_pos, existing);
+        if (existing != Lattice::empty) {
+            cells_.set_coord(existing, orig_pos);
+            if (dormant_[existing] && num_empty_neighbors<C>(pack<C>(orig_pos)) > 0U) domain_wake(d, existing);
+        } else {
+            domain_wake_neighbors<C>(d, pack<C>(orig_pos));
+        }
+        domain_schedule(d, x);
+    }
+}
+
+void Tissue::domain_push(Domain& d, const double t, const uint32_t x) {
+    schedule_[x] = t;
+    if (d.serial) {
+        route(t, x);
+    } else if (d.contains(cells_.coord(x))) {
+        d.push(t, x);
+    } else {
+        domain_defer(d, t, x);
+    }
+}
+
+void Tissue::domain_defer(Domain& d, const double t, const uint32_t x) {
+    d.outbox.emplace_back(t, x);
+    d.fence.insert(cells_.coord(x), t);
+}
+
+void Tissue::domain_schedule(Domain& d, const uint32_t x, const bool surrounded) {
+    const double dt = cells_.delta_time(x, d.engine, d.time, positional_value(cells_.coord(x)), surrounded);
+    domain_push(d, d.time + dt, x);
+}
+
+void Tissue::domain_park(Domain& d, const uint32_t x) {
+    const double dt = cells_.delta_time_dormant(x, d.engine);
+    domain_push(d, d.time + dt, x);
+    dormant_[x] = 1u;
+    ++d.dormant;
+}
+
+void Tissue::domain_wake(Domain& d, const uint32_t x) {
+    if (!dormant_[x]) return;
+    dormant_[x] = 0u;
+    --d.dormant;
+    domain_schedule(d, x, true);
+}
+
+template <class C>
+void Tissue::domain_wake_neighbors(Domain& d, const packed_t vacated) {
+    for (const auto step: C::packed_table) {
+        const uint32_t neighbor = lattice_->get(vacated + step);
+        if (neighbor != Lattice::empty) domain_wake(d, neighbor);
+    }
+}
+
+uint32_t Tissue::domain_record(Domain& d, const uint32_t x) {
+    if (d.serial) return genealogy_.append(cells_, x, d.time);
+    const auto i = static_cast<uint32_t>(d.record);
+    d.record += num_domains_;
+    return genealogy_.assign(i, cells_, x, d.time);
+}
+
+unsigned Tissue::domain_id(Domain& d) {
+    if (d.serial) return ++id_tail_;
+    const auto id = static_cast<unsigned>(d.id);
+    d.id += num_domains_;
+    return id;
+}
+
+void Tissue::route(const double t, const uint32_t x) {
+    const auto& v = cells_.coord(x);
+    size_t k = 0u;
+    for (unsigned j = MAX_DIM; j-- > 0u;) {
+        const auto& cuts = cuts_[j];
+        const auto i = std::upper_bound(cuts.begin(), cuts.end(), v[j]) - cuts.begin();
+        k = k * (cuts.size() + 1u) + static_cast<size_t>(i);
+    }
+    auto& d = domains_[k];
+    if (d.contains(v)) {
+        d.push(t, x);
+    } else {
+        domains_.back().push(t, x);
+    }
+}
+
+void Tissue::partition() {
+    std::vector<Domain::event_type> events;
+    for (auto& d: domains_) {
+        for (const auto& e: d.heap) {
+            if (schedule_[e.second] == e.first) events.push_back(e);
+        }
+        d.heap.clear();
+    }
+    // prime factors are spread over axes from the largest
+    const unsigned dimensions = coord_func_->dimensions();
+    std::vector<unsigned> factors;
+    for (unsigned n = num_domains_, p = 2u; n > 1u;) {
+        if (n % p == 0u) {
+            factors.push_back(p);
+            n /= p;
+        } else {
+            ++p;
+        }
+    }
+    std::array<unsigned, MAX_DIM> splits{};
+    splits.fill(1u);
+    for (auto it = factors.rbegin(); it != factors.rend(); ++it) {
+        *std::min_element(splits.begin(), splits.begin() + dimensions) *= *it;
+    }
+    // quantiles of each axis
+    std::vector<int> values;
+    values.reserve(size());
+    for (unsigned j = 0u; j < MAX_DIM; ++j) {
+        cuts_[j].clear();
+        if (splits[j] < 2u) continue;
+        values.clear();
+        for (uint32_t x = 1u; x < cells_.slots(); ++x) {
+            if (cells_.contains(x)) values.push_back(cells_.coord(x)[j]);
+        }
+        auto first = values.begin();
+        for (unsigned k = 1u; k < splits[j]; ++k) {
+            const auto nth = values.begin() + static_cast<std::ptrdiff_t>(values.size() * k / splits[j]);
+            std::nth_element(first, nth, values.end());
+            cuts_[j].push_back(*nth);
+            first = nth;
+        }
+    }
+    for (size_t k = 0u; k < num_domains_; ++k) {
+        auto& d = domains_[k];
+        size_t rest = k;
+        for (unsigned j = 0u; j < MAX_DIM; ++j) {
+            const auto& cuts = cuts_[j];
+            const size_t i = rest % (cuts.size() + 1u);
+            rest /= cuts.size() + 1u;
+            d.lower[j] = (i == 0u) ? INT_MIN : cuts[i - 1u] + Domain::margin;
+            d.upper[j] = (i == cuts.size()) ? INT_MAX : cuts[i] - Domain::margin;
+        }
+    }
+    for (const auto& e: events) route(e.first, e.second);
+}
+
+void Tissue::reserve_domains(const size_t n) {
+    // boxes take contiguous shares of handles, and every num_domains_-th
+    // record, ID, and clone, so that unused ones are left only by imbalance
+    const size_t share = std::max(n / num_domains_, size_t{1u});
+    const size_t total = share * num_domains_;
+    reserved_.clear();
+    cells_.reserve(total, &reserved_);
+    dormant_.resize(cells_.slots(), 0u);
+    schedule_.resize(cells_.slots(), -1.0);
+    record_base_ = genealogy_.reserve(total);
+    clone_base_ = cells_.mutates() ? cells_.reserve_clones(total / 4u) : cells_.num_clones();
+    for (unsigned k = 0u; k < num_domains_; ++k) {
+        auto& d = domains_[k];
+        d.handle = k * share;
+        d.handle_end = d.handle + share;
+        d.record = record_base_ + k;
+        d.record_end = record_base_ + total;
+        d.id = id_tail_ + 1u + k;
+        d.shard.next_clone = static_cast<uint32_t>(clone_base_ + k);
+        d.shard.end_clone = static_cast<uint32_t>(cells_.num_clones());
+        d.shard.stride = num_domains_;
+    }
+}
+
+void Tissue::merge_domain(Domain& d) {
+    if (d.error) std::rethrow_exception(d.error);
+    cells_.count(&d.shard);
+    for (const auto x: d.dead) cells_.release(x);
+    d.dead.clear();
+    num_dormant_ = static_cast<size_t>(static_cast<long>(num_dormant_) + d.dormant);
+    d.dormant = 0;
+    drivers_ << d.drivers.str();
+    d.drivers.str("");
+    auto& boundary = domains_.back();
+    for (const auto& e: d.outbox) boundary.push(e.first, e.second);
+    d.outbox.clear();
+}
+
+void Tissue::release_domains() {
+    const size_t stride = num_domains_;
+    size_t record_end = record_base_;
+    size_t clone_end = clone_base_;
+    unsigned id_tail = id_tail_;
+    for (unsigned k = 0u; k < num_domains_; ++k) {
+        auto& d = domains_[k];
+        merge_domain(d);
+        cells_.unreserve(reserved_.data() + d.handle, reserved_.data() + d.handle_end);
+        // a stride past the last one taken, if any
+        if (d.record >= record_base_ + stride) record_end = std::max(record_end, d.record + 1u - stride);
+        if (d.shard.next_clone >= clone_base_ + stride) {
+            clone_end = std::max(clone_end, d.shard.next_clone + 1u - stride);
+        }
+        if (d.id > id_tail_ + stride) id_tail = std::max(id_tail, static_cast<unsigned>(d.id - stride));
+    }
+    // records, IDs, and clones left between those taken remain as placeholders
+    genealogy_.truncate(record_end);
+    genealogy_.spill();
+    id_tail_ = id_tail;
+    cells_.truncate_clones(clone_end);
+}
+
+void Tissue::gather_domains() {
+    for (auto& d: domains_) {
+        for (const auto& e: d.heap) {
+            if (schedule_[e.second] == e.first && !queue_->contains(e.second)) {
+                queue_->push(e.first, e.second);
             }
         }
-        return false;
-    });
-    swtch["linear"].emplace("mindrag", [this](const std::shared_ptr<Cell>& daughter) {
-        daughter->add_coord(coord_func_->random_direction(*engine_));
-        return extant_cells_.insert(daughter).second;
-    });
+        d.heap.clear();
+    }
+}
+
+void Tissue::plateau(const double time) {
+    std::fill(dormant_.begin(), dormant_.end(), 0u);
+    num_dormant_ = 0u;
+    cells_.increase_death_rate();
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (!cells_.contains(i)) continue;
+        queue_push(i);
+    }
+    grow(std::numeric_limits<size_t>::max(), time_ + time);
+}
+
+void Tissue::treatment(const double death_prob, const size_t num_resistant_cells) {
+    const size_t original_size = size();
+    // death_prob of dormant cells is changed as well
+    for (uint32_t i = 1u; i < dormant_.size() && num_dormant_ > 0u; ++i) {
+        wake(i);
+    }
+    auto handles = queue_->handles(); // for reproducibility
+    std::shuffle(handles.begin(), handles.end(), *engine_);
+    handles.erase(handles.begin(), handles.begin() + std::min(num_resistant_cells, original_size));
+    cells_.set_cycle_dependent_death(handles, *engine_, death_prob);
+}
+
+void Tissue::queue_push(const uint32_t x, const bool surrounded) {
+    double dt = cells_.delta_time(x, *engine_, time_, positional_value(cells_.coord(x)), surrounded);
+    dt += time_;
+    if (queue_->contains(x)) {
+        queue_->update(x, dt);
+    } else {
+        queue_->push(dt, x);
+    }
+}
+
+void Tissue::park(const uint32_t x) {
+    const double dt = cells_.delta_time_dormant(x, *engine_);
+    queue_->push(time_ + dt, x);
+    dormant_[x] = 1u;
+    ++num_dormant_;
+}
+
+void Tissue::wake(const uint32_t x) {
+    if (!dormant_[x]) return;
+    dormant_[x] = 0u;
+    --num_dormant_;
+    queue_push(x, true);
+}
+
+template <class C>
+void Tissue::wake_neighbors(const packed_t vacated) {
+    if (num_dormant_ == 0u) return;
+    for (const auto step: C::packed_table) {
+        const uint32_t neighbor = lattice_->get(vacated + step);
+        if (neighbor != Lattice::empty) wake(neighbor);
+    }
+}
+
+uint32_t Tissue::allocate(const uint32_t mother) {
+    const uint32_t handle = cells_.clone(mother);
+    if (handle >= dormant_.size()) dormant_.resize(handle + 1u, 0u);
+    return handle;
+}
+
+bool Tissue::emplace(const uint32_t x) {
+    const auto& coord = cells_.coord(x);
+    if (lattice_->get(coord) != Lattice::empty) return false;
+    lattice_->set(coord, x);
+    return true;
+}
+
+template <class C>
+void Tissue::init_grow_impl(const std::string& local_density_effect, const std::string& displacement_path) {
+    using map_sf = std::unordered_map<std::string, decltype(grow_impl_)>;
+    std::unordered_map<std::string, map_sf> swtch;
+    if (local_density_effect != "const") {
+        // num_empty_neighbors() is called on every birth attempt
+        lattice_->count_neighbors(coord_func_->directions());
+    }
+    if (local_density_effect == "const"
+        && (displacement_path == "mindrag" || displacement_path == "minstraight"
+            || displacement_path == "shortest")) {
+        // to_nearest_empty() is called on every birth
+        surface_ = std::make_unique<SurfaceDistance>(*coord_func_);
+    }
+    swtch["const"]["random"] = &Tissue::grow_impl<C, Density::constant, Path::random>;
+    swtch["const"]["mindrag"] = &Tissue::grow_impl<C, Density::constant, Path::mindrag>;
+    swtch["const"]["minstraight"] = &Tissue::grow_impl<C, Density::constant, Path::minstraight>;
+    swtch["const"]["roulette"] = &Tissue::grow_impl<C, Density::constant, Path::roulette>;
+    swtch["const"]["stroll"] = &Tissue::grow_impl<C, Density::constant, Path::stroll>;
+    swtch["const"]["shortest"] = &Tissue::grow_impl<C, Density::constant, Path::shortest>;
+    swtch["step"]["random"] = &Tissue::grow_impl<C, Density::step, Path::random>;
+    swtch["step"]["mindrag"] = &Tissue::grow_impl<C, Density::step, Path::mindrag>;
+    swtch["linear"]["random"] = &Tissue::grow_impl<C, Density::linear, Path::random>;
+    swtch["linear"]["mindrag"] = &Tissue::grow_impl<C, Density::linear, Path::mindrag>;
+    if (num_domains_ > 0u) {
+        dense_ = dynamic_cast<DenseLattice*>(lattice_.get());
+        if (!dense_) throw std::runtime_error("--engine conservative requires --lattice dense");
+        swtch.clear();
+        swtch["step"]["mindrag"] = &Tissue::grow_domains<C, Density::step>;
+        swtch["linear"]["mindrag"] = &Tissue::grow_domains<C, Density::linear>;
+    }
     try {
-        insert = swtch.at(local_density_effect).at(displacement_path);
+        grow_impl_ = swtch.at(local_density_effect).at(displacement_path);
     } catch (std::exception& e) {
         std::ostringstream oss;
         oss << "\n" << __FILE__ << ':' << __LINE__ << ':' << __PRETTY_FUNCTION__
@@ -227,162 +814,405 @@ void Tissue::init_insert_function(const std::string& local_density_effect, const
     }
 }
 
-void Tissue::push(std::shared_ptr<Cell> moving, const coord_t& direction) {
-    do {
-        moving->add_coord(direction);
-    } while (swap_existing(&moving));
+template <class C, Tissue::Density L, Tissue::Path P>
+bool Tissue::insert(const uint32_t daughter) {
+    if constexpr (L == Density::constant) {
+        if constexpr (P == Path::mindrag || P == Path::minstraight || P == Path::shortest) {
+            if (surface_->is_stale(size())) surface_->build(*lattice_, cells_);
+        }
+        if constexpr (P == Path::random) {
+            push<C>(daughter, random_direction<C>(*engine_));
+        } else if constexpr (P == Path::mindrag) {
+            push_minimum_drag<C>(daughter);
+        } else if constexpr (P == Path::minstraight) {
+            push<C>(daughter, to_nearest_empty<C>(cells_.coord(daughter)));
+        } else if constexpr (P == Path::roulette) {
+            // roulette_direction() needs rays in all directions on every birth
+            if (size() >= ray_index_size(C::num_dimensions) && !lattice_->indexes_rays()) {
+                index_rays();
+            }
+            push<C>(daughter, roulette_direction<C>(cells_.coord(daughter)));
+        } else if constexpr (P == Path::shortest) {
+            push_shortest<C>(daughter);
+        } else {
+            stroll<C>(daughter, random_direction<C>(*engine_));
+        }
+        return true;
+    } else if constexpr (L == Density::step) {
+        if constexpr (P == Path::random) {
+            if (num_empty_neighbors<C>(pack<C>(cells_.coord(daughter))) == 0U) {return false;}
+            push<C>(daughter, random_direction<C>(*engine_));
+            return true;
+        } else {
+            return insert_adjacent<C>(daughter);
+        }
+    } else {
+        if constexpr (P == Path::random) {
+            const auto x = num_empty_neighbors<C>(pack<C>(cells_.coord(daughter)));
+            if (x > 0U) {
+                double prob = x;
+                prob /= C::table.size();
+                if (wtl::generate_canonical(*engine_) < prob) {
+                    push<C>(daughter, random_direction<C>(*engine_));
+                    return true;
+                }
+            }
+            return false;
+        } else {
+            cells_.add_coord(daughter, random_direction<C>(*engine_));
+            return emplace(daughter);
+        }
+    }
 }
 
-void Tissue::push_minimum_drag(std::shared_ptr<Cell> moving) {
+template <class C>
+void Tissue::push(const uint32_t moving, const coord_t& direction) {
+    const packed_t step = pack_direction<C>(direction);
+    packed_t key = pack<C>(cells_.coord(moving));
+    chain_.clear();
+    chain_.push_back(moving);
+    packed_t end = key + step;
+    for (uint32_t x = lattice_->get(end); x != Lattice::empty; x = lattice_->get(end)) {
+        chain_.push_back(x);
+        end += step;
+    }
+    if (benchmark_) benchmark_->push_chain(chain_.size() - 1u);
+    // Each site is stored once; sites ahead of x are not updated yet
+    // when num_empty_neighbors() is checked, as in swap_existing().
+    for (const uint32_t x: chain_) {
+        cells_.add_coord(x, direction);
+        key += step;
+        lattice_->exchange(key, x);
+        if (is_dormant(x) && num_empty_neighbors<C>(key) > 0U) wake(x);
+    }
+}
+
+template <class C>
+void Tissue::push_minimum_drag(uint32_t moving) {
+    size_t n = 0u;
     do {
-        moving->add_coord(to_nearest_empty(moving->coord()));
-    } while (swap_existing(&moving));
+        cells_.add_coord(moving, to_nearest_empty<C>(cells_.coord(moving)));
+        ++n;
+    } while (swap_existing<C>(&moving, pack<C>(cells_.coord(moving))));
+    if (benchmark_) benchmark_->push_chain(n - 1u);
+}
+
+template <class C>
+void Tissue::push_shortest(const uint32_t moving) {
+    if (!shortest_.find<C>(cells_.coord(moving), *lattice_, *surface_, *engine_)) {
+        push<C>(moving, to_nearest_empty<C>(cells_.coord(moving)));
+        return;
+    }
+    const auto& path = shortest_.path();
+    chain_.assign(1u, moving);
+    for (size_t k = path.size(); --k > 0u;) {
+        chain_.push_back(lattice_->get(path[k]));
+    }
+    if (benchmark_) benchmark_->push_chain(chain_.size() - 1u);
+    // shift every cell by one site along the path; one store per site
+    for (size_t m = 0u; m < chain_.size(); ++m) {
+        const uint32_t x = chain_[m];
+        const packed_t key = path[path.size() - 1u - m];
+        cells_.set_coord(x, unpack(key, C::num_dimensions));
+        lattice_->exchange(key, x);
+        if (is_dormant(x) && num_empty_neighbors<C>(key) > 0U) wake(x);
+    }
 }
 
-void Tissue::stroll(std::shared_ptr<Cell> moving, const coord_t& direction) {
-    while (!insert_adjacent(moving)) {
-        moving->add_coord(direction);
-        swap_existing(&moving);
+template <class C>
+void Tissue::stroll(uint32_t moving, const coord_t& direction) {
+    const packed_t step = pack_direction<C>(direction);
+    packed_t key = pack<C>(cells_.coord(moving));
+    while (!insert_adjacent<C>(moving)) {
+        cells_.add_coord(moving, direction);
+        key += step;
+        swap_existing<C>(&moving, key);
     }
 }
 
-bool Tissue::insert_adjacent(const std::shared_ptr<Cell>& moving) {
-    const auto present_coord = moving->coord();
-    const auto& directions = coord_func_->directions();
-    thread_local auto indices = wtl::seq_len<unsigned>(directions.size());
+template <class C>
+bool Tissue::insert_adjacent(const uint32_t moving) {
+    constexpr const auto& directions = C::table;
+    auto& indices = adjacent_order_;
     std::shuffle(indices.begin(), indices.end(), *engine_);
     for (const auto i: indices) {
-        moving->add_coord(directions[i]);
-        if (extant_cells_.insert(moving).second) {
+        const auto neighbor = cells_.coord(moving) + directions[i];
+        if (lattice_->get(neighbor) == Lattice::empty) {
+            cells_.set_coord(moving, neighbor);
+            lattice_->set(neighbor, moving);
             return true;
         }
-        moving->set_coord(present_coord);
     }
     return false;
 }
 
-bool Tissue::swap_existing(std::shared_ptr<Cell>* x) {
-    auto result = extant_cells_.insert(*x);
-    if (result.second) {
-        return false;
-    } else {
-        std::shared_ptr<Cell> existing = std::move(*result.first);
-        extant_cells_.insert(extant_cells_.erase(result.first), std::move(*x));
-        *x = std::move(existing);
-        return true;
-    }
+template <class C>
+bool Tissue::swap_existing(uint32_t* x, const packed_t key) {
+    const uint32_t existing = lattice_->exchange(key, *x);
+    if (is_dormant(*x) && num_empty_neighbors<C>(key) > 0U) wake(*x);
+    if (existing == Lattice::empty) return false;
+    *x = existing;
+    return true;
 }
 
-void Tissue::migrate(const std::shared_ptr<Cell>& migrant) {
-    extant_cells_.erase(migrant);
-    auto orig_pos = migrant->coord();
-    migrant->add_coord(coord_func_->random_direction(*engine_));
-    auto result = extant_cells_.insert(migrant);
-    if (!result.second) {
-        std::shared_ptr<Cell> existing = std::move(*result.first);
-        extant_cells_.insert(extant_cells_.erase(result.first), migrant);
-        existing->set_coord(std::move(orig_pos));
-        extant_cells_.insert(std::move(existing));
+template <class C>
+void Tissue::migrate(const uint32_t migrant) {
+    const auto orig_pos = cells_.coord(migrant);
+    cells_.add_coord(migrant, random_direction<C>(*engine_));
+    const uint32_t existing = lattice_->exchange(cells_.coord(migrant), migrant);
+    lattice_->set(orig_pos, existing);
+    if (existing != Lattice::empty) {
+        cells_.set_coord(existing, orig_pos);
+        if (is_dormant(existing) && num_empty_neighbors<C>(pack<C>(orig_pos)) > 0U) wake(existing);
+    } else {
+        wake_neighbors<C>(pack<C>(orig_pos));
+        if (surface_) surface_->vacate(orig_pos);
     }
 }
 
-size_t Tissue::steps_to_empty(const coord_t& current, const coord_t& direction) const {
-    thread_local const auto key = std::make_shared<Cell>();
-    const auto& end = extant_cells_.end();
-    key->set_coord(current);
+size_t Tissue::steps_to_empty(packed_t current, const packed_t step) const {
     size_t steps = 0;
     do {
-        key->add_coord(direction);
+        current += step;
         ++steps;
-    } while (extant_cells_.find(key) != end);
+    } while (lattice_->get(current) != Lattice::empty);
     return steps;
 }
 
+template <class C>
 const coord_t& Tissue::to_nearest_empty(const coord_t& current) const {
-    thread_local const auto key = std::make_shared<Cell>();
-    const auto& end = extant_cells_.end();
-    const auto& directions = coord_func_->directions();
-    thread_local auto indices = wtl::seq_len<unsigned>(directions.size());
+    constexpr const auto& directions = C::table;
+    auto& indices = nearest_order_;
     std::shuffle(indices.begin(), indices.end(), *engine_);
-    for (int radius = 1; true; ++radius) {
+    // no empty site is closer than the lower bound
+    int radius = 1;
+    if (surface_) radius = std::max(radius, static_cast<int>(surface_->lower_bound(current, *lattice_)));
+    for (; true; ++radius) {
         for (const auto i: indices) {
-            key->set_coord(current + directions[i] * radius);
-            if (extant_cells_.find(key) == end) {
+            if (lattice_->get(current + directions[i] * radius) == Lattice::empty) {
                 return directions[i];
             }
         }
     }
 }
 
-coord_t Tissue::roulette_direction(const coord_t& current) const {
-    auto directions = coord_func_->directions();
-    std::shuffle(directions.begin(), directions.end(), *engine_);
-    std::vector<double> roulette;
-    for (const auto& d: directions) {
-        const auto l = steps_to_empty(current, d);
-        if (l == 0U) {return d;}
-        roulette.push_back(1.0 / l);
+template <class C>
+const coord_t& Tissue::roulette_direction(const coord_t& current) const {
+    constexpr const auto& directions = C::table;
+    constexpr size_t n = directions.size();
+    // same draws as shuffling a copy of directions
+    std::array<unsigned, n> indices{};
+    std::iota(indices.begin(), indices.end(), 0u);
+    std::shuffle(indices.begin(), indices.end(), *engine_);
+    std::array<double, n> cumulative{};
+    for (size_t k = 0u; k < n; ++k) {
+        const auto l = lattice_->indexes_rays()
+          ? lattice_->steps_to_empty(current, indices[k])
+          : steps_to_empty(pack<C>(current), C::packed_table[indices[k]]);
+        cumulative[k] = 1.0 / l;
     }
-    std::discrete_distribution<unsigned> discrete(roulette.begin(), roulette.end());
-    return directions[discrete(*engine_)];
+    // same as std::discrete_distribution in libstdc++ without allocation
+    const double sum = std::accumulate(cumulative.begin(), cumulative.end(), 0.0);
+    for (auto& p: cumulative) p /= sum;
+    std::partial_sum(cumulative.begin(), cumulative.end(), cumulative.begin());
+    cumulative.back() = 1.0;
+    const double p = std::generate_canonical<double, std::numeric_limits<double>::digits>(*engine_);
+    const auto it = std::lower_bound(cumulative.begin(), cumulative.end(), p);
+    return directions[indices[static_cast<size_t>(it - cumulative.begin())]];
 }
 
-uint_fast8_t Tissue::num_empty_neighbors(const coord_t& coord) const {
-    thread_local auto nb = std::make_shared<Cell>();
-    const auto& end = extant_cells_.end();
+void Tissue::index_rays() {
+    std::vector<coord_t> occupied;
+    occupied.reserve(size());
+    for (uint32_t x = 1u; x < cells_.slots(); ++x) {
+        if (cells_.contains(x)) occupied.push_back(cells_.coord(x));
+    }
+    lattice_->index_rays(coord_func_->directions(), occupied);
+}
+
+template <class C>
+uint_fast8_t Tissue::num_empty_neighbors(const packed_t key) const {
+    constexpr const auto& steps = C::packed_table;
+    if (lattice_->counts_neighbors()) {
+        const auto occupied = lattice_->num_occupied_neighbors(key);
+        return static_cast<uint_fast8_t>(steps.size() - occupied);
+    }
     uint_fast8_t cnt = 0;
-    for (const auto& d: coord_func_->directions()) {
-        nb->set_coord(coord + d);
-        if (extant_cells_.find(nb) == end) {++cnt;}
+    for (const auto step: steps) {
+        if (lattice_->get(key + step) == Lattice::empty) {++cnt;}
     }
     return cnt;
 }
 
-void Tissue::entomb(const std::shared_ptr<Cell>& dead) {
-    dead->set_time_of_death(time_);
-    dead->traceback(cemetery_, &recorded_);
-    extant_cells_.erase(dead);
+template <class C>
+void Tissue::entomb(const uint32_t dead) {
+    genealogy_.append(cells_, dead, time_);
+    const auto coord = cells_.coord(dead);
+    lattice_->erase(coord);
+    wake_neighbors<C>(pack<C>(coord));
+    if (surface_) surface_->vacate(coord);
+    cells_.release(dead);
 }
 
 std::ostream& Tissue::write_history(std::ostream& ost) const {
     ost.precision(std::cout.precision());
     ost << Cell::header() << "\n";
-    wtl::write_if_avail(ost, cemetery_.rdbuf());
-    for (const auto& p: extant_cells_) {
-        p->traceback(ost, &recorded_);
+    genealogy_.write(ost);
+    return ost << *this;
+}
+
+TableWriter& Tissue::write_history(TableWriter& table) const {
+    genealogy_.write(table);
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (cells_.contains(i)) genealogy_.record(cells_, i).write(table);
     }
-    return ost;
+    return table;
+}
+
+void Tissue::stream_history(const std::string& path, const bool columnar) {
+    if (prune_) throw std::runtime_error("history cannot be streamed with --prune");
+    history_path_ = path;
+    if (columnar) {
+        history_table_ = std::make_unique<TableWriter>(path, Cell::columns());
+        genealogy_.stream(history_table_.get(), history_chunk);
+        compact_threshold_ = history_chunk;
+        return;
+    }
+    history_ = std::make_unique<wtl::zlib::ofstream>(path);
+    history_->exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    history_->precision(std::cout.precision());
+    *history_ << Cell::header() << "\n";
+    genealogy_.stream(history_.get(), history_chunk);
+    compact_threshold_ = history_chunk;
+}
+
+void Tissue::finish_history(const std::string& path) {
+    if (history_table_) {
+        write_history(*history_table_);
+        history_table_->close();
+        genealogy_.stop_stream();
+        compact_threshold_ = SIZE_MAX;
+        history_table_.reset();
+    } else {
+        genealogy_.write(*history_);
+        *history_ << *this;
+        genealogy_.stop_stream();
+        compact_threshold_ = SIZE_MAX;
+        history_.reset();
+    }
+    std::filesystem::rename(history_path_, path);
 }
 
 std::ostream& Tissue::write_snapshots(std::ostream& ost) const {
+    ost.precision(std::cout.precision());
     ost << "time\t" << Cell::header() << "\n";
-    wtl::write_if_avail(ost, snapshots_.rdbuf());
+    TsvWriter tsv(ost);
+    for (const auto& [time, cell]: snapshots_) {
+        cell.write(tsv << time << '\t') << '\n';
+    }
+    tsv.flush();
     return ost;
 }
 
+TableWriter& Tissue::write_snapshots(TableWriter& table) const {
+    for (const auto& [time, cell]: snapshots_) {
+        table << time;
+        cell.write(table);
+    }
+    return table;
+}
+
 std::ostream& Tissue::write_drivers(std::ostream& ost) const {
     ost << "id\ttype\tcoef\n";
     wtl::write_if_avail(ost, drivers_.rdbuf());
     return ost;
 }
 
+TableWriter& Tissue::write_drivers(TableWriter& table) const {
+    // drivers are few and kept in text; coef has the precision of TSV
+    std::istringstream iss(drivers_.str());
+    uint32_t id = 0u;
+    std::string type;
+    double coef = 0.0;
+    while (iss >> id >> type >> coef) {
+        table << id << type << coef;
+    }
+    return table;
+}
+
+std::vector<Column> Tissue::snapshot_columns() {
+    auto columns = Cell::columns();
+    columns.insert(columns.begin(), Column{"time", Column::Type::float64});
+    return columns;
+}
+
+std::vector<Column> Tissue::driver_columns() {
+    return {
+      {"id", Column::Type::uint32},
+      {"type", Column::Type::string},
+      {"coef", Column::Type::float64}
+    };
+}
+
 std::ostream& Tissue::write_benchmark(std::ostream& ost) const {
-    benchmark_->append(extant_cells_.size() + 1u);
+    benchmark_->append(size() + 1u);
     wtl::write_if_avail(ost, benchmark_->rdbuf());
     return ost;
 }
 
+std::ostream& Tissue::write_push_chains(std::ostream& ost) const {
+    wtl::write_if_avail(ost, benchmark_->push_chains_rdbuf());
+    return ost;
+}
+
 void Tissue::snapshots_append() {
-    for (const auto& p: extant_cells_) {
-        snapshots_ << time_ << "\t" << *p << "\n";
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (!cells_.contains(i)) continue;
+        snapshots_.emplace_back(time_, genealogy_.record(cells_, i));
+        if (prune_) sampled_.push_back(cells_.ancestor(i));
+    }
+}
+
+void Tissue::prune() {
+    std::sort(sampled_.begin(), sampled_.end());
+    sampled_.erase(std::unique(sampled_.begin(), sampled_.end()), sampled_.end());
+    std::vector<uint32_t> roots;
+    roots.reserve(size() + sampled_.size());
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (cells_.contains(i)) roots.push_back(cells_.ancestor(i));
+    }
+    roots.insert(roots.end(), sampled_.begin(), sampled_.end());
+    genealogy_.prune(&roots);
+    auto it = roots.begin();
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (cells_.contains(i)) cells_.set_ancestor(i, *it++);
+    }
+    sampled_.assign(it, roots.end());
+    prune_threshold_ = 2u * (genealogy_.size() + size());
+}
+
+void Tissue::compact_history() {
+    std::vector<uint32_t> roots;
+    roots.reserve(size());
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (cells_.contains(i)) roots.push_back(cells_.ancestor(i));
+    }
+    genealogy_.compact(&roots);
+    auto it = roots.begin();
+    for (uint32_t i = 1u; i < cells_.slots(); ++i) {
+        if (cells_.contains(i)) cells_.set_ancestor(i, *it++);
     }
+    compact_threshold_ = std::max(2u * (genealogy_.size() + size()), history_chunk);
 }
 
 //! Stream operator for debug print
 std::ostream& operator<< (std::ostream& ost, const Tissue& tissue) {
-    for (const auto& p: tissue.extant_cells_) {
-        ost << *p << "\n";
+    const auto& cells = tissue.cells_;
+    TsvWriter tsv(ost);
+    for (uint32_t i = 1u; i < cells.slots(); ++i) {
+        if (cells.contains(i)) tissue.genealogy_.record(cells, i).write(tsv) << '\n';
     }
+    tsv.flush();
     return ost;
 }
 
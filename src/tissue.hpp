@@ -6,17 +6,24 @@
 #define TUMOPP_TISSUE_HPP_
 
 #include "coord.hpp"
-#include "cell.hpp"
+#include "cell_store.hpp"
+#include "genealogy.hpp"
+#include "lattice.hpp"
+#include "event_queue.hpp"
+#include "surface.hpp"
+#include "shortest_path.hpp"
+#include "domain.hpp"
 #include "random.hpp"
+#include "table.hpp"
 
 #include <cstdint>
 #include <sstream>
 #include <string>
 #include <array>
-#include <unordered_set>
-#include <map>
+#include <atomic>
+#include <vector>
 #include <memory>
-#include <functional>
+#include <utility>
 
 namespace tumopp {
 
@@ -33,10 +40,16 @@ class Tissue {
       const std::string& coordinate="moore",
       const std::string& local_density_effect="const",
       const std::string& displacement_path="random",
+      const std::string& lattice="dense",
+      const std::string& queue="heap",
       const EventRates& init_event_rates=EventRates{},
+      const CellParams& cell_params=CellParams{},
       uint32_t seed=std::random_device{}(),
       bool verbose=false,
-      bool enable_benchmark=false);
+      bool enable_benchmark=false,
+      bool prune=false,
+      const std::string& engine="serial",
+      unsigned threads=1u);
     ~Tissue();
 
     //! main function
@@ -47,124 +60,308 @@ class Tissue {
       size_t recording_early_growth=0u,
       size_t mutation_timing=0u);
 
+    //! Make grow() return false as soon as possible; safe to call from another thread
+    void cancel() noexcept {cancelled_.store(true, std::memory_order_relaxed);}
+
     //! Simulate turnover with the increased death_rate
     void plateau(double time);
     //! Simulate medical treatment with the increased death_prob
     void treatment(double death_prob, size_t num_resistant_cells = 3u);
 
-    //! Write #extant_cells_ and their ancestors
+    //! Write extant cells and their ancestors; only those in memory after stream_history()
     std::ostream& write_history(std::ostream&) const;
+    //! Write extant cells and their ancestors in TCF; columns are Cell::columns()
+    TableWriter& write_history(TableWriter&) const;
+    //! Write ancestors to a file at path as they accumulate, in gzipped TSV or TCF if columnar,
+    //! instead of keeping them in memory until write_history(); not with --prune
+    void stream_history(const std::string& path, bool columnar = false);
+    //! Append the rest of the history to the file of stream_history(), and move it to path
+    void finish_history(const std::string& path);
     //! Write #snapshots_
     std::ostream& write_snapshots(std::ostream&) const;
+    //! Write #snapshots_ in TCF; columns are snapshot_columns()
+    TableWriter& write_snapshots(TableWriter&) const;
     //! Write #drivers_
     std::ostream& write_drivers(std::ostream&) const;
+    //! Write #drivers_ in TCF; columns are driver_columns()
+    TableWriter& write_drivers(TableWriter&) const;
+    //! Columns of write_snapshots()
+    static std::vector<Column> snapshot_columns();
+    //! Columns of write_drivers()
+    static std::vector<Column> driver_columns();
     //! Write #benchmark_
     std::ostream& write_benchmark(std::ostream&) const;
+    //! Write histogram of push chains in #benchmark_; call after write_benchmark()
+    std::ostream& write_push_chains(std::ostream&) const;
     friend std::ostream& operator<< (std::ostream&, const Tissue&);
 
     //! @cond
-    bool has_snapshots() const {return snapshots_.rdbuf()->in_avail();};
+    bool has_snapshots() const {return !snapshots_.empty();};
     bool has_drivers() const {return drivers_.rdbuf()->in_avail();}
     bool has_benchmark() const {return bool(benchmark_);}
+    bool streams_history() const {return history_ || history_table_;}
     //! @endcond
 
     //! @name Getter functions
     //@{
     //! Get the number of extant cells
-    size_t size() const noexcept {return extant_cells_.size();}
+    size_t size() const noexcept {return cells_.size();}
+    //! Get the number of cells whose birth is suspended by park()
+    size_t num_dormant() const noexcept {return num_dormant_;}
+    //! Get the number of windows in which boxes of --engine conservative ran in parallel
+    size_t num_parallel_windows() const noexcept {return parallel_windows_;}
+    //! Get the number of records in memory or referred to by extant cells
+    size_t num_records() const noexcept {return genealogy_.size();}
     //@}
 
   private:
-    //! Set #coord_func_
-    void init_coord(unsigned dimensions, const std::string& coordinate);
-    //! Set #insert function
-    void init_insert_function(const std::string& local_density_effect, const std::string& displacement_path);
-    //! initialized in init_insert_function()
-    std::function<bool(const std::shared_ptr<Cell>&)> insert;
+    //! Local density effect on birth (-L)
+    enum class Density {constant, step, linear};
+    //! Path of displacement by a new cell (-P)
+    enum class Path {random, mindrag, minstraight, roulette, stroll, shortest};
+
+    //! Set #coord_func_ and #grow_impl_
+    void init_coord(unsigned dimensions, const std::string& coordinate,
+                    const std::string& local_density_effect, const std::string& displacement_path);
+    //! Instantiate hot paths for the coordinate system C
+    template <class C>
+    void init_policy(const std::string& local_density_effect, const std::string& displacement_path);
+    //! Set #lattice_
+    void init_lattice(unsigned dimensions, const std::string& lattice);
+    //! Set #queue_
+    void init_queue(const std::string& queue);
+    //! Set #num_domains_
+    void init_engine(const std::string& engine, unsigned threads);
+    //! Select #grow_impl_ from -L and -P
+    template <class C>
+    void init_grow_impl(const std::string& local_density_effect, const std::string& displacement_path);
 
+    //! grow() with the coordinate system C, density effect L, and path P
+    template <class C, Density L, Path P>
+    bool grow_impl(size_t max_size, double max_time, double snapshot_interval,
+                   size_t recording_early_growth, size_t mutation_timing);
+    //! grow() with boxes of cells in parallel (--engine conservative);
+    //! only for -L step/linear with -P mindrag, whose events touch sites
+    //! within #domain_reach of the cell, and for --lattice dense.
+    //! Events earlier than the end of a time window are processed in each box
+    //! without synchronization, except those within Fence::width() of an earlier event
+    //! of a cell near the other boxes or of another deferred event;
+    //! they are processed serially after the boxes in time order.
+    //! Windows are shortened while deferred events outnumber those of a box.
+    //! Boxes touch only their own resources and fences,
+    //! so that the result is reproducible for the same seed and number of boxes.
+    //! An optimistic engine for -P random is not implemented; see @ref optimistic.
+    template <class C, Density L>
+    bool grow_domains(size_t max_size, double max_time, double snapshot_interval,
+                      size_t recording_early_growth, size_t mutation_timing);
+    //! Process events of d earlier than t
+    template <class C, Density L>
+    void run_domain(Domain& d, double t);
+    //! Process events of all #domains_ earlier than t in time order
+    template <class C, Density L>
+    void run_serial(double t);
+    //! Record events in heap earlier than t in #fence_
+    void fence_heap(const std::vector<Domain::event_type>& heap, double t);
+    //! Check if the event of x can be processed in d without synchronization;
+    //! false if d has run out of its reserved resources
+    template <class C>
+    bool domain_ready(Domain& d, uint32_t x);
+    //! Birth, death, or migration of x in d
+    template <class C, Density L>
+    void domain_event(Domain& d, uint32_t x);
+    //! Schedule x at t in d, or route() it if d is serial
+    void domain_push(Domain& d, double t, uint32_t x);
+    //! Move the event of x at t to Domain::outbox and Domain::fence
+    void domain_defer(Domain& d, double t, uint32_t x);
+    //! queue_push() in d
+    void domain_schedule(Domain& d, uint32_t x, bool surrounded=false);
+    //! park() in d
+    void domain_park(Domain& d, uint32_t x);
+    //! wake() in d
+    void domain_wake(Domain& d, uint32_t x);
+    //! wake_neighbors() in d
+    template <class C>
+    void domain_wake_neighbors(Domain& d, packed_t vacated);
+    //! Append the record of x to #genealogy_ in d
+    uint32_t domain_record(Domain& d, uint32_t x);
+    //! Next ID in d
+    unsigned domain_id(Domain& d);
+    //! Push an event to the heap of the box of x or to the last of #domains_
+    void route(double t, uint32_t x);
+    //! Set #cuts_ to quantiles of coordinates and route() all events again
+    void partition();
+    //! Reserve resources for n events in a window
+    void reserve_domains(size_t n);
+    //! Merge the changes of d and move its #Domain::outbox to the boundary
+    void merge_domain(Domain& d);
+    //! Merge the boxes and release resources left after a window
+    void release_domains();
+    //! Move events from #domains_ back to #queue_
+    void gather_domains();
+    //! Put a daughter cell on #lattice_; false if it fails due to L
+    template <class C, Density L, Path P>
+    bool insert(uint32_t daughter);
     //! Swap with a random neighbor
-    void migrate(const std::shared_ptr<Cell>&);
-    //! Emplace daughter cell and push other cells to the direction
-    void push(std::shared_ptr<Cell> moving, const coord_t& direction);
+    template <class C>
+    void migrate(uint32_t);
+    //! Emplace daughter cell and push other cells to the direction;
+    //! the ray is walked to the nearest empty site before shifting cells
+    template <class C>
+    void push(uint32_t moving, const coord_t& direction);
     //! Push through the minimum drag path
-    void push_minimum_drag(std::shared_ptr<Cell> moving);
+    template <class C>
+    void push_minimum_drag(uint32_t moving);
+    //! Push cells along a shortest path to the nearest empty site
+    //! found by ShortestPath within its radius;
+    //! fall back to the straight path of -P minstraight if none is found
+    template <class C>
+    void push_shortest(uint32_t moving);
     //! Try insert_adjacent() on every step in push()
-    void stroll(std::shared_ptr<Cell> moving, const coord_t& direction);
+    template <class C>
+    void stroll(uint32_t moving, const coord_t& direction);
     //! Insert x if any adjacent node is empty
-    bool insert_adjacent(const std::shared_ptr<Cell>& x);
+    template <class C>
+    bool insert_adjacent(uint32_t x);
     //! Put new cell and return existing.
-    bool swap_existing(std::shared_ptr<Cell>* x);
-    //! Count steps to the nearest empty
-    size_t steps_to_empty(const coord_t& current, const coord_t& direction) const;
+    template <class C>
+    bool swap_existing(uint32_t* x, packed_t key);
+    //! Count steps to the nearest empty along pack_direction()
+    size_t steps_to_empty(packed_t current, packed_t step) const;
     //! Direction to the nearest empty
+    template <class C>
     const coord_t& to_nearest_empty(const coord_t& current) const;
     //! Direction is selected with a probability proportional with 1/l
-    coord_t roulette_direction(const coord_t& current) const;
+    template <class C>
+    const coord_t& roulette_direction(const coord_t& current) const;
+    //! Start Lattice::index_rays() with the current cells
+    void index_rays();
 
-    //! Count adjacent empty sites
-    uint_fast8_t num_empty_neighbors(const coord_t&) const;
+    //! Count adjacent empty sites; O(1) if Lattice::counts_neighbors()
+    template <class C>
+    uint_fast8_t num_empty_neighbors(packed_t key) const;
     //! TODO: Calculate positional value
     double positional_value(const coord_t&) const {return 1.0;}
 
-    //! Push a cell to event #queue_
-    void queue_push(const std::shared_ptr<Cell>&, bool surrounded=false);
+    //! Push a cell to event #queue_ or reschedule it in place
+    void queue_push(uint32_t, bool surrounded=false);
+    //! Suspend birth of a surrounded cell until it gets an empty neighbor;
+    //! only if CellStore::parkable()
+    void park(uint32_t);
+    //! Resume birth of a dormant cell
+    void wake(uint32_t);
+    //! Check if birth is suspended
+    bool is_dormant(uint32_t x) const {return dormant_[x];}
+    //! wake() cells around a site that has become empty
+    template <class C>
+    void wake_neighbors(packed_t vacated);
     //! Put a cell to #cemetery_
-    void entomb(const std::shared_ptr<Cell>&);
+    template <class C>
+    void entomb(uint32_t);
+    //! Store a copy of a cell in #cells_ and return its handle
+    uint32_t allocate(uint32_t mother);
+    //! Put x on #lattice_ if the site is empty
+    bool emplace(uint32_t x);
     //! Write all cells to #snapshots_ with #time_
     void snapshots_append();
-
-    /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
-    // Function object for extant_cells_
-
-    //! Hashing function object for shared_pointer<Cell>
-    struct hash_ptr_cell {
-        //! hash function
-        size_t operator() (const std::shared_ptr<tumopp::Cell>& x) const noexcept {
-            return hash(x->coord());
-        }
-    };
-
-    //! Equal function object for shared_pointer<Cell>
-    struct equal_ptr_cell {
-        //! Compare cell coord
-        bool operator() (const std::shared_ptr<tumopp::Cell>& lhs,
-                         const std::shared_ptr<tumopp::Cell>& rhs) const noexcept {
-            return lhs->coord() == rhs->coord();
-        }
-    };
+    //! Drop records in #genealogy_ that are not ancestors of extant or sampled cells
+    void prune();
+    //! Drop IDs in #genealogy_ that extant cells do not refer to after stream_history()
+    void compact_history();
 
     /////1/////////2/////////3/////////4/////////5/////////6/////////7/////////
     // Data member
 
-    //! cells
-    std::unordered_set<
-        std::shared_ptr<Cell>,
-        hash_ptr_cell,
-        equal_ptr_cell> extant_cells_{};
+    //! extant cells; handles are shared with #lattice_ and #queue_
+    CellStore cells_{};
+    //! handles of #cells_ arranged in space; initialized in init_lattice()
+    std::unique_ptr<Lattice> lattice_{nullptr};
     //! incremented when a new cell is born
     unsigned id_tail_{0};
 
-    //! event queue
-    std::multimap<double, std::shared_ptr<Cell>> queue_{};
+    //! event queue; initialized in init_queue()
+    std::unique_ptr<EventQueue> queue_{nullptr};
+    //! whether birth is suspended, indexed by handle; not bits to be written by threads
+    std::vector<uint8_t> dormant_{0u};
+    //! number of dormant cells
+    size_t num_dormant_{0u};
     //! continuous time
     double time_{0.0};
-    //! initialized in init_coord() or init_coord_test()
+    //! initialized in init_coord()
     std::unique_ptr<Coord> coord_func_{nullptr};
+    //! lower bounds of distance to empty sites; only for -L const with -P mindrag/minstraight/shortest
+    std::unique_ptr<SurfaceDistance> surface_{nullptr};
+    //! grow_impl() instantiated for #coord_func_, -L, and -P; set in init_coord()
+    bool (Tissue::*grow_impl_)(size_t, double, double, size_t, size_t){nullptr};
 
-    //! record dead cells
-    std::stringstream cemetery_{};
-    //! record snapshots
-    std::stringstream snapshots_{};
+    //! records of divided or dead cells
+    Genealogy genealogy_{};
+    //! ancestors of cells written to #snapshots_; kept by prune()
+    std::vector<uint32_t> sampled_{};
+    //! number of records written at once to #history_
+    static constexpr size_t history_chunk = 1u << 16u;
+    //! file of stream_history(); removed by the destructor unless finished
+    std::unique_ptr<std::ostream> history_{nullptr};
+    //! file of stream_history() in TCF
+    std::unique_ptr<TableWriter> history_table_{nullptr};
+    //! path of #history_ or #history_table_
+    std::string history_path_{};
+    //! prune() is called if #genealogy_ grows larger than this
+    size_t prune_threshold_{0u};
+    //! compact_history() is called if #genealogy_ grows larger than this
+    size_t compact_threshold_{SIZE_MAX};
+    //! enable prune()
+    bool prune_{false};
+    //! record snapshots: time and cell
+    std::vector<std::pair<double, Cell>> snapshots_{};
     //! record driver mutations
     std::stringstream drivers_{};
-    //! id of recorded cells
-    mutable std::unordered_set<unsigned> recorded_{};
     //! record resource usage
     std::unique_ptr<Benchmark> benchmark_{nullptr};
     //! random number generator
     std::unique_ptr<urbg_t> engine_{nullptr};
+    //! order of directions shuffled in insert_adjacent()
+    std::vector<unsigned> adjacent_order_{};
+    //! order of directions shuffled in to_nearest_empty()
+    mutable std::vector<unsigned> nearest_order_{};
+    //! cells along the ray in push(); reused to avoid allocation
+    std::vector<uint32_t> chain_{};
+    //! search of push_shortest()
+    ShortestPath shortest_{};
+    //! -P roulette indexes rays when the tumor grows to this size;
+    //! walking is faster while rays are short
+    static constexpr size_t ray_index_size(unsigned dimensions) noexcept {
+        return dimensions == 1u ? 0u : (dimensions == 2u ? 1u << 12u : 1u << 20u);
+    }
+    //! maximum distance from a cell to sites read or written by its event in grow_domains()
+    static constexpr int domain_reach = 2;
+    //! target number of events per box in a window of grow_domains()
+    static constexpr size_t domain_events = 4096u;
+    //! minimum number of events per box in a window of grow_domains()
+    static constexpr size_t domain_min_events = 64u;
+    //! number of boxes for --engine conservative; 0 for the serial engine
+    unsigned num_domains_{0u};
+    //! boxes followed by the boundary processed serially; see grow_domains()
+    std::vector<Domain> domains_{};
+    //! boundaries between boxes along each axis
+    std::array<std::vector<int>, MAX_DIM> cuts_{};
+    //! scheduled time of each handle in grow_domains(); -1 if not scheduled
+    std::vector<double> schedule_{};
+    //! handles reserved for a window of grow_domains()
+    std::vector<uint32_t> reserved_{};
+    //! first record of #genealogy_ reserved for a window of grow_domains()
+    size_t record_base_{0u};
+    //! first clone reserved for a window of grow_domains()
+    size_t clone_base_{0u};
+    //! #lattice_ for grow_domains()
+    DenseLattice* dense_{nullptr};
+    //! earliest events of the boundary in a window; read by every box
+    Fence fence_{};
+    //! number of windows in which boxes processed events in parallel
+    size_t parallel_windows_{0u};
     //! print debug info
     bool verbose_{false};
+    //! set by cancel()
+    std::atomic<bool> cancelled_{false};
 };
 
 } // namespace tumopp
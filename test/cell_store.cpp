@@ -0,0 +1,33 @@
+#include "cell_store.hpp"
+#include "genealogy.hpp"
+
+#include <iostream>
+
+int main() {
+    std::cout << "bytes per cell: " << tumopp::CellStore::bytes_per_cell << "\n";
+    tumopp::CellStore cells;
+    const uint32_t first = cells.emplace({{1, 2, 3}}, 1u, tumopp::EventRates{});
+    const uint32_t second = cells.clone(first);
+    if (first != 1u || second != 2u || cells.size() != 2u) return 1;
+    if (cells.coord(second) != cells.coord(first)) return 1;
+    tumopp::Genealogy genealogy;
+    cells.set_time_of_birth(second, 1.0, 2u, genealogy.append(cells, first, 1.0));
+    std::cout << tumopp::Cell::header() << "\n"
+              << genealogy.record(cells, second, 2.0) << "\n";
+    genealogy.write(std::cout);
+    if (genealogy.size() != 1u) return 1;
+    cells.release(first);
+    if (cells.contains(first) || cells.size() != 1u) return 1;
+    // the vacant slot is reused
+    if (cells.clone(second) != first || cells.slots() != 3u) return 1;
+    // cells share a clone until a mutation
+    if (cells.num_clones() != 1u || cells.clone_size(0u) != 2u) return 1;
+    tumopp::urbg_t engine(42u);
+    std::cout << cells.force_mutate(first, engine);
+    if (cells.num_clones() != 2u || cells.clone_index(first) != 1u) return 1;
+    if (cells.clone_size(0u) != 1u || cells.clone_size(1u) != 1u) return 1;
+    cells.set_cycle_dependent_death({first, second}, engine, 0.5);
+    if (cells.num_clones() != 4u || cells.death_prob(second) != 0.5) return 1;
+    if (cells.clone_size(0u) != 0u || cells.clone_size(1u) != 0u) return 1;
+    return 0;
+}
@@ -6,3 +6,25 @@ rm -r $TMP_OUT
 
 ./tumopp -Chex -Lstep -Pmindrag -N255 -o$TMP_OUT
 rm -r $TMP_OUT
+
+./tumopp -P shortest -N 20000 -o $TMP_OUT
+rm -r $TMP_OUT
+
+./tumopp -N 255 --replicates 3 -j 2 -o $TMP_OUT
+test -f $TMP_OUT/rep_2/population.tsv.gz
+rm -r $TMP_OUT
+
+./tumopp -N 255 -d 0.8 -j 2 -o $TMP_OUT
+rm -r $TMP_OUT
+
+./tumopp -L step -P mindrag --engine conservative -j 2 -N 20000 -o $TMP_OUT
+rm -r $TMP_OUT
+
+if ./tumopp -L step -P random --engine conservative -N 255 -o $TMP_OUT; then exit 1; fi
+test ! -e $TMP_OUT
+
+./tumopp -N 255 -I 2 -U 100 --ub 0.1 -d 0.2 --format tcf -o $TMP_OUT
+test -f $TMP_OUT/population.tcf
+./tumopp-tcf $TMP_OUT/population.tcf $TMP_OUT/snapshots.tcf $TMP_OUT/drivers.tcf > /dev/null
+./tumopp-tcf -s $TMP_OUT/population.tcf
+rm -r $TMP_OUT
@@ -1,30 +1,58 @@
 #include "coord.hpp"
 
 #include <wtl/iostr.hpp>
+#include <algorithm>
 #include <typeinfo>
 
 template <class T> inline
-void test_coordinate(unsigned dim, const tumopp::coord_t& v) {
-    std::cout << typeid(T).name() << " " << dim << "D ################\n";
-    T coord_func(dim);
+int test_coordinate(const tumopp::coord_t& v) {
+    T coord_func;
+    std::cout << typeid(T).name() << " " << coord_func.dimensions() << "D ################\n";
     for (auto x: coord_func.directions()) {
         std::cout << x << ": " << coord_func.euclidean_distance(x) << "\n";
     }
     std::cout << "core:        " << coord_func.core() << "\n";
     std::cout << "dist_g:      " << coord_func.graph_distance(v) << "\n";
     std::cout << "dist_e:      " << coord_func.euclidean_distance(v) << "\n";
+    // compile-time table and runtime choice must agree
+    const auto& directions = coord_func.directions();
+    if (!std::equal(directions.begin(), directions.end(), T::table.begin(), T::table.end())) return 1;
+    // a step on packed keys is the same as a step on coordinates
+    for (size_t i = 0u; i < T::table.size(); ++i) {
+        using tumopp::operator+;
+        const tumopp::coord_t u = v + T::table[i];
+        if (tumopp::pack<T>(v) + T::packed_table[i] != tumopp::pack<T>(u)) return 1;
+        if (tumopp::unpack(tumopp::pack<T>(u), T::num_dimensions) != u) return 1;
+    }
+    std::mt19937 engine0(42u), engine1(42u);
+    for (int i = 0; i < 100; ++i) {
+        if (coord_func.random_direction(engine0) != tumopp::random_direction<T>(engine1)) return 1;
+    }
+    return 0;
 }
 
-void test_dimension(unsigned dim, tumopp::coord_t&& v) {
-    test_coordinate<tumopp::Neumann>(dim, v);
-    test_coordinate<tumopp::Moore>(dim, v);
-    test_coordinate<tumopp::Hexagonal>(dim, v);
+template <unsigned D> inline
+int test_dimension(const tumopp::coord_t& v) {
+    return test_coordinate<tumopp::Neumann<D>>(v)
+         + test_coordinate<tumopp::Moore<D>>(v)
+         + test_coordinate<tumopp::Hexagonal<D>>(v);
 }
 
 int main() {
     std::cout.precision(9);
-    test_dimension(1u, {1, 0, 0});
-    test_dimension(2u, {1, -2, 0});
-    test_dimension(3u, {1, -2, 3});
-    return 0;
+    static_assert(tumopp::Moore<3u>::table.size() == 26u);
+    static_assert(tumopp::Hexagonal<3u>::table.size() == 12u);
+    // the field width depends on dimensions
+    static_assert(tumopp::packed_bits(1u) == 32u && tumopp::packed_bits(3u) == 21u);
+    constexpr tumopp::coord_t edge{{(1 << 20) - 2, 1 - (1 << 20), 0}};
+    static_assert(tumopp::unpack(tumopp::pack(edge, 3u), 3u)[1] == edge[1]);
+    static_assert(tumopp::is_packable(edge, 3u) && tumopp::is_packable(tumopp::pack(edge, 3u), 3u));
+    static_assert(!tumopp::is_packable(tumopp::pack(edge, 3u) + tumopp::pack_direction({{1, 0, 0}}, 3u), 3u));
+    static_assert(tumopp::is_packable(edge, 2u));
+    constexpr tumopp::coord_t wide{{2000000000, -2000000000, 0}};
+    static_assert(tumopp::unpack(tumopp::pack(wide, 2u), 2u)[1] == wide[1]);
+    static_assert(tumopp::is_packable(wide, 2u) && !tumopp::is_packable(wide, 3u));
+    return test_dimension<1u>({1, 0, 0})
+         + test_dimension<2u>({1, -2, 0})
+         + test_dimension<3u>({1, -2, 3});
 }
@@ -0,0 +1,165 @@
+#include "tissue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+//! Check that extant cells occupy distinct sites, IDs are unique, and ancestors are recorded
+inline int check_history(const tumopp::Tissue& tissue) {
+    std::stringstream history;
+    tissue.write_history(history);
+    std::string line;
+    std::getline(history, line);
+    std::set<std::tuple<int, int, int>> sites;
+    std::set<unsigned> ids;
+    std::set<unsigned> ancestors;
+    size_t extant = 0u;
+    while (std::getline(history, line)) {
+        std::istringstream iss(line);
+        int x = 0, y = 0, z = 0;
+        unsigned id = 0u, ancestor = 0u;
+        double birth = 0.0, death = 0.0;
+        iss >> x >> y >> z >> id >> ancestor >> birth >> death;
+        if (!ids.insert(id).second) {
+            std::cerr << "duplicated id " << id << "\n";
+            return 1;
+        }
+        if (ancestor > 0u) ancestors.insert(ancestor);
+        if (death > 0.0) continue;
+        ++extant;
+        if (!sites.emplace(x, y, z).second) {
+            std::cerr << "overlapping cells at " << x << " " << y << " " << z << "\n";
+            return 1;
+        }
+    }
+    for (const auto ancestor: ancestors) {
+        if (ids.count(ancestor) == 0u) {
+            std::cerr << "missing ancestor " << ancestor << "\n";
+            return 1;
+        }
+    }
+    if (extant != tissue.size()) {
+        std::cerr << "extant " << extant << " != size " << tissue.size() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+inline int test_domains(const unsigned dimensions, const std::string& local,
+                        const tumopp::EventRates& rates, const tumopp::CellParams& params,
+                        const unsigned threads) {
+    constexpr size_t max_size = 60000u;
+    for (uint32_t seed = 42u; true; ++seed) {
+        tumopp::Tissue tissue(1u, dimensions, "moore", local, "mindrag", "dense", "heap",
+                              rates, params, seed, false, false, false, "conservative", threads);
+        if (!tissue.grow(max_size, 1e9)) continue;  // extinct
+        std::cout << dimensions << "D -L " << local << " -j " << threads
+                  << ": " << tissue.size() << "\n";
+        if (tissue.size() != max_size) {
+            std::cerr << "size " << tissue.size() << " != " << max_size << "\n";
+            return 1;
+        }
+        return check_history(tissue);
+    }
+}
+
+//! Check that the same seed gives the same history regardless of the timing of threads
+inline int test_reproducible() {
+    constexpr size_t max_size = 100000u;
+    std::string first;
+    for (int i = 0; i < 3; ++i) {
+        tumopp::Tissue tissue(1u, 3u, "moore", "step", "mindrag", "dense", "heap",
+                              tumopp::EventRates{}, tumopp::CellParams{}, 42u, false, false, false, "conservative", 4u);
+        tissue.grow(max_size, 1e9);
+        std::ostringstream history;
+        tissue.write_history(history);
+        if (i == 0) {
+            first = history.str();
+        } else if (history.str() != first) {
+            std::cerr << "history differs with the same seed\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//! Time from size to the last birth; valid without death
+inline double growth_time(const tumopp::Tissue& tissue, const size_t size) {
+    std::stringstream history;
+    tissue.write_history(history);
+    std::string line;
+    std::getline(history, line);
+    std::vector<double> births;
+    while (std::getline(history, line)) {
+        std::istringstream iss(line);
+        int x = 0, y = 0, z = 0;
+        unsigned id = 0u, ancestor = 0u;
+        double birth = 0.0;
+        iss >> x >> y >> z >> id >> ancestor >> birth;
+        births.push_back(birth);
+    }
+    std::sort(births.begin(), births.end());
+    // daughters of the (size - 1)-th division are born at births[2 * (size - 1)]
+    return births.back() - births.at(2u * (size - 1u));
+}
+
+//! Check that boxes run in parallel for several windows
+//! and that boundary events are not delayed against the serial engine
+inline int test_windows() {
+    constexpr size_t max_size = 250000u;
+    constexpr unsigned threads = 8u;
+    // grow_domains() starts boxes around this size
+    constexpr size_t start = 4096u * threads;
+    const tumopp::EventRates rates;
+    const tumopp::CellParams params;
+    double serial = 0.0;
+    double conservative = 0.0;
+    for (const uint32_t seed: {1u, 2u}) {
+        for (const std::string engine: {"serial", "conservative"}) {
+            tumopp::Tissue tissue(1u, 3u, "moore", "step", "mindrag", "dense", "heap",
+                                  rates, params, seed, false, false, false, engine, threads);
+            if (!tissue.grow(max_size, 1e9)) return 1;
+            const double t = growth_time(tissue, start);
+            std::cout << engine << ": " << t << " from " << start << " to " << max_size
+                      << " in " << tissue.num_parallel_windows() << " parallel windows\n";
+            if (engine == "serial") {
+                serial += t / 2.0;
+                continue;
+            }
+            conservative += t / 2.0;
+            if (tissue.num_parallel_windows() < 16u) {
+                std::cerr << "too few parallel windows\n";
+                return 1;
+            }
+            if (check_history(tissue) != 0) return 1;
+        }
+    }
+    // the standard deviation of a run is about 0.015
+    if (std::abs(conservative - serial) > 0.05) {
+        std::cerr << "growth time " << conservative << " != " << serial << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main() {
+    tumopp::EventRates rates;
+    tumopp::CellParams params;
+    int failures = 0;
+    failures += test_domains(3u, "step", rates, params, 8u);
+    failures += test_domains(2u, "linear", rates, params, 3u);
+    rates.death_rate = 0.2;
+    rates.migration_rate = 0.5;
+    params.RATE_BIRTH = 0.01;
+    params.RATE_DEATH = 0.01;
+    failures += test_domains(3u, "step", rates, params, 4u);
+    failures += test_domains(3u, "linear", rates, params, 2u);
+    failures += test_reproducible();
+    failures += test_windows();
+    return failures;
+}
@@ -0,0 +1,117 @@
+#include "lattice.hpp"
+
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <typeinfo>
+#include <vector>
+
+template <class T> inline
+int test_lattice(unsigned dim) {
+    std::cout << typeid(T).name() << " " << dim << "D\n";
+    T lattice(dim);
+    const tumopp::coord_t origin{};
+    tumopp::coord_t far{{-40, 25, 70}};
+    for (unsigned j = dim; j < tumopp::MAX_DIM; ++j) far[j] = 0;
+    lattice.set(origin, 1u);
+    std::cout << "capacity: " << lattice.capacity() << "\n";
+    lattice.set(far, 2u);
+    std::cout << "capacity: " << lattice.capacity() << "\n";
+    if (lattice.get(origin) != 1u || lattice.get(far) != 2u) return 1;
+    if (lattice.exchange(far, 3u) != 2u) return 1;
+    lattice.erase(origin);
+    if (lattice.get(origin) != tumopp::Lattice::empty) return 1;
+    if (lattice.get({{1000, 0, 0}}) != tumopp::Lattice::empty) return 1;
+    if (lattice.get(tumopp::pack(far, dim)) != 3u) return 1;
+    try {
+        lattice.set({{static_cast<int>(tumopp::packed_limit(dim) - 1), 0, 0}}, 4u);
+        return 1;
+    } catch (const std::runtime_error&) {}
+    return 0;
+}
+
+template <class T, unsigned dim> inline
+int test_counts() {
+    using tumopp::operator+;
+    const tumopp::Moore<dim> coord_func;
+    const auto& directions = coord_func.directions();
+    T lattice(dim);
+    lattice.count_neighbors(directions);
+    std::mt19937 engine(42u);
+    std::uniform_int_distribution<int> uniform(-12, 12);
+    for (uint32_t i = 1u; i < 3000u; ++i) {
+        tumopp::coord_t v{};
+        for (unsigned j = 0u; j < dim; ++j) v[j] = uniform(engine);
+        lattice.set(v, (i % 3u == 0u) ? tumopp::Lattice::empty : i);
+    }
+    for (int x = -13; x <= 13; ++x) {
+        tumopp::coord_t v{{x, x / 2, -x}};
+        for (unsigned j = dim; j < tumopp::MAX_DIM; ++j) v[j] = 0;
+        unsigned expected = 0u;
+        for (const auto& d: directions) {
+            if (lattice.get(v + d) != tumopp::Lattice::empty) ++expected;
+        }
+        if (lattice.num_occupied_neighbors(v) != expected) return 1;
+    }
+    std::cout << "counts ok: " << lattice.capacity() << "\n";
+    return 0;
+}
+
+template <class T, class C> inline
+int test_rays(bool late) {
+    using tumopp::operator+;
+    constexpr unsigned dim = C::num_dimensions;
+    const C coord_func;
+    const auto& directions = coord_func.directions();
+    T lattice(dim);
+    if (!late) lattice.index_rays(directions);
+    std::mt19937 engine(42u);
+    std::uniform_int_distribution<int> uniform(-8, 8);
+    std::vector<tumopp::coord_t> sites;
+    for (uint32_t i = 1u; i < 3000u; ++i) {
+        tumopp::coord_t v{};
+        for (unsigned j = 0u; j < dim; ++j) v[j] = uniform(engine);
+        lattice.set(v, (i % 3u == 0u) ? tumopp::Lattice::empty : i);
+        sites.push_back(v);
+    }
+    if (late) {
+        // index the sites occupied so far, then keep it updated
+        std::vector<tumopp::coord_t> occupied;
+        for (const auto& v: sites) {
+            if (lattice.get(v) != tumopp::Lattice::empty) occupied.push_back(v);
+        }
+        lattice.index_rays(directions, occupied);
+        for (size_t k = 0u; k < sites.size(); k += 7u) lattice.erase(sites[k]);
+        for (size_t k = 0u; k < sites.size(); k += 11u) lattice.set(sites[k], 1u);
+    }
+    for (int x = -9; x <= 9; ++x) {
+        tumopp::coord_t v{{x, x / 2, -x}};
+        for (unsigned j = dim; j < tumopp::MAX_DIM; ++j) v[j] = 0;
+        for (size_t i = 0u; i < directions.size(); ++i) {
+            unsigned expected = 0u;
+            auto current = v;
+            do {
+                current = current + directions[i];
+                ++expected;
+            } while (lattice.get(current) != tumopp::Lattice::empty);
+            if (lattice.steps_to_empty(v, i) != expected) return 1;
+        }
+    }
+    std::cout << "rays ok: " << typeid(C).name() << "\n";
+    return 0;
+}
+
+template <class T> inline
+int test_dimensions() {
+    return test_lattice<T>(1u) + test_lattice<T>(2u) + test_lattice<T>(3u)
+         + test_counts<T, 1u>() + test_counts<T, 2u>() + test_counts<T, 3u>()
+         + test_rays<T, tumopp::Moore<1u>>(false) + test_rays<T, tumopp::Neumann<2u>>(false)
+         + test_rays<T, tumopp::Moore<3u>>(false) + test_rays<T, tumopp::Hexagonal<3u>>(false)
+         + test_rays<T, tumopp::Moore<3u>>(true) + test_rays<T, tumopp::Hexagonal<3u>>(true);
+}
+
+int main() {
+    return test_dimensions<tumopp::DenseLattice>()
+         + test_dimensions<tumopp::BrickLattice>()
+         + test_dimensions<tumopp::HashLattice>();
+}
@@ -0,0 +1,122 @@
+#include "event_queue.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <typeinfo>
+
+//! Pop all events and check if they are in the same order
+inline int test_equivalence(tumopp::EventQueue& lhs, tumopp::EventQueue& rhs) {
+    if (lhs.size() != rhs.size()) return 1;
+    if (lhs.handles() != rhs.handles()) return 1;
+    while (!lhs.empty()) {
+        if (lhs.top() != rhs.top()) return 1;
+        lhs.pop();
+        rhs.pop();
+    }
+    return rhs.empty() ? 0 : 1;
+}
+
+template <class T> inline
+int test_operations() {
+    tumopp::MultimapQueue reference;
+    T queue;
+    std::mt19937_64 engine(42u);
+    std::exponential_distribution<double> exponential(1.0);
+    std::uniform_int_distribution<uint32_t> uniform(1u, 999u);
+    for (uint32_t x = 1u; x < 1000u; ++x) {
+        const double t = exponential(engine);
+        reference.push(t, x);
+        queue.push(t, x);
+    }
+    for (int i = 0; i < 3000; ++i) {
+        const uint32_t x = uniform(engine);
+        if (reference.contains(x) != queue.contains(x)) return 1;
+        if (!reference.contains(x)) {
+            const double t = exponential(engine);
+            reference.push(t, x);
+            queue.push(t, x);
+        } else if (i % 3 == 0) {
+            reference.erase(x);
+            queue.erase(x);
+        } else {
+            const double t = exponential(engine);
+            reference.update(x, t);
+            queue.update(x, t);
+        }
+    }
+    reference.push(std::numeric_limits<double>::infinity(), 1000u);
+    queue.push(std::numeric_limits<double>::infinity(), 1000u);
+    std::cout << typeid(T).name() << ": " << queue.size() << "\n";
+    return test_equivalence(reference, queue);
+}
+
+//! Check that events with equal times are ordered by push() and update()
+template <class T> inline
+int test_ties() {
+    tumopp::MultimapQueue reference;
+    T queue;
+    std::mt19937_64 engine(42u);
+    std::uniform_int_distribution<int> day(0, 3);
+    std::uniform_int_distribution<uint32_t> uniform(1u, 999u);
+    const auto draw = [&]() {
+        const int d = day(engine);
+        return d == 3 ? std::numeric_limits<double>::infinity() : static_cast<double>(d);
+    };
+    for (uint32_t x = 1u; x < 1000u; ++x) {
+        const double t = draw();
+        reference.push(t, x);
+        queue.push(t, x);
+    }
+    for (int i = 0; i < 2000; ++i) {
+        const uint32_t x = uniform(engine);
+        const double t = draw();
+        if (!reference.contains(x)) {
+            reference.push(t, x);
+            queue.push(t, x);
+        } else if (i % 3 == 0) {
+            reference.erase(x);
+            queue.erase(x);
+        } else {
+            reference.update(x, t);
+            queue.update(x, t);
+        }
+    }
+    return test_equivalence(reference, queue);
+}
+
+//! Hold model: pop the earliest event and reschedule it at a later time
+//! drawn from the gamma distribution with shape k and mean 1
+template <class T> inline
+void benchmark(size_t n, double k) {
+    T queue;
+    std::mt19937_64 engine(42u);
+    std::gamma_distribution<double> gamma(k, 1.0 / k);
+    for (uint32_t x = 1u; x <= n; ++x) {
+        queue.push(gamma(engine), x);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0u; i < 4u * n; ++i) {
+        const auto next = queue.top();
+        queue.pop();
+        queue.push(next.first + gamma(engine), next.second);
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << typeid(T).name() << " " << n << " k=" << k << " "
+              << elapsed.count() << " ms\n";
+}
+
+int main(int argc, char* argv[]) {
+    const size_t n = argc > 1 ? std::stoul(argv[1]) : 10000u;
+    for (const double k: {1.0, 10.0, 100.0}) {
+        benchmark<tumopp::MultimapQueue>(n, k);
+        benchmark<tumopp::HeapQueue>(n, k);
+        benchmark<tumopp::CalendarQueue>(n, k);
+    }
+    return test_operations<tumopp::HeapQueue>()
+         + test_operations<tumopp::CalendarQueue>()
+         + test_ties<tumopp::HeapQueue>()
+         + test_ties<tumopp::CalendarQueue>();
+}
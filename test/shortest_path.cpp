@@ -0,0 +1,136 @@
+#include "shortest_path.hpp"
+#include "cell_store.hpp"
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <typeinfo>
+
+//! Breadth-first search from v to the nearest empty site
+inline unsigned distance_to_empty(const tumopp::Lattice& lattice, const tumopp::Coord& coord_func, const tumopp::coord_t& v) {
+    using tumopp::operator+;
+    std::map<tumopp::coord_t, unsigned> visited{{v, 0u}};
+    std::deque<tumopp::coord_t> queue{v};
+    while (true) {
+        const auto current = queue.front();
+        queue.pop_front();
+        const unsigned next = visited[current] + 1u;
+        for (const auto& d: coord_func.directions()) {
+            const auto neighbor = current + d;
+            if (lattice.get(neighbor) == tumopp::Lattice::empty) return next;
+            if (visited.emplace(neighbor, next).second) queue.push_back(neighbor);
+        }
+    }
+}
+
+//! Check if a and b are adjacent
+template <class C> inline
+bool adjacent(tumopp::packed_t a, tumopp::packed_t b) {
+    for (const auto step: C::packed_table) {
+        if (a + step == b) return true;
+    }
+    return false;
+}
+
+//! Fill sites within the graph distance radius from the origin
+inline void fill(tumopp::Lattice* lattice, tumopp::CellStore* cells, const tumopp::Coord& coord_func, int radius) {
+    tumopp::coord_t v{};
+    for (v[0] = -radius; v[0] <= radius; ++v[0]) {
+        for (v[1] = -radius; v[1] <= radius; ++v[1]) {
+            for (v[2] = -radius; v[2] <= radius; ++v[2]) {
+                bool unused = false;
+                for (unsigned j = coord_func.dimensions(); j < tumopp::MAX_DIM; ++j) unused |= (v[j] != 0);
+                if (unused || coord_func.graph_distance(v) > radius) continue;
+                lattice->set(v, cells->emplace(v, static_cast<unsigned>(cells->slots()), tumopp::EventRates{}));
+            }
+        }
+    }
+}
+
+//! Check that every path is as long as the graph distance to the nearest empty site
+template <class C> inline
+int test_distance() {
+    const C coord_func;
+    std::cout << typeid(C).name() << "\n";
+    tumopp::DenseLattice lattice(coord_func.dimensions());
+    tumopp::CellStore cells;
+    tumopp::SurfaceDistance surface(coord_func);
+    tumopp::ShortestPath search;
+    fill(&lattice, &cells, coord_func, 6);
+    surface.build(lattice, cells);
+    // holes make lower bounds inexact
+    std::mt19937 engine(42u);
+    for (int i = 0; i < 20; ++i) {
+        std::uniform_int_distribution<uint32_t> uniform(1u, static_cast<uint32_t>(cells.slots() - 1u));
+        const uint32_t x = uniform(engine);
+        if (!cells.contains(x)) continue;
+        const auto v = cells.coord(x);
+        lattice.erase(v);
+        cells.release(x);
+        surface.vacate(v);
+    }
+    for (uint32_t x = 1u; x < cells.slots(); ++x) {
+        if (!cells.contains(x)) continue;
+        const auto& v = cells.coord(x);
+        if (!search.find<C>(v, lattice, surface, engine)) {
+            std::cerr << "no path within the window\n";
+            return 1;
+        }
+        const auto& path = search.path();
+        const unsigned distance = distance_to_empty(lattice, coord_func, v);
+        if (path.size() != distance) {
+            std::cerr << "path " << path.size() << " != distance " << distance << "\n";
+            return 1;
+        }
+        if (lattice.get(path.front()) != tumopp::Lattice::empty) return 1;
+        for (size_t k = 1u; k < path.size(); ++k) {
+            if (lattice.get(path[k]) == tumopp::Lattice::empty) return 1;
+            if (!adjacent<C>(path[k], path[k - 1u])) return 1;
+        }
+        if (!adjacent<C>(tumopp::pack<C>(v), path.back())) return 1;
+    }
+    return 0;
+}
+
+//! Check that no path is found if the window has no empty site,
+//! so that Tissue::push_shortest() falls back to -P minstraight
+inline int test_fallback() {
+    using C = tumopp::Neumann<2u>;
+    const C coord_func;
+    constexpr int radius = tumopp::ShortestPath::radius(2u);
+    tumopp::DenseLattice lattice(coord_func.dimensions());
+    tumopp::CellStore cells;
+    tumopp::SurfaceDistance surface(coord_func);
+    tumopp::ShortestPath search;
+    std::mt19937 engine(42u);
+    fill(&lattice, &cells, coord_func, radius + 8);
+    const tumopp::coord_t origin{};
+    // the lower bound of the origin exceeds the radius
+    surface.build(lattice, cells);
+    if (search.find<C>(origin, lattice, surface, engine)) return 1;
+    // the lower bound is within the radius but the hole has been filled
+    const tumopp::coord_t hole{radius / 2, 0, 0};
+    cells.release(lattice.exchange(hole, tumopp::Lattice::empty));
+    surface.build(lattice, cells);
+    if (!search.find<C>(origin, lattice, surface, engine)) return 1;
+    if (search.path().size() != static_cast<size_t>(radius / 2)) return 1;
+    lattice.set(hole, cells.emplace(hole, 0u, tumopp::EventRates{}));
+    if (search.find<C>(origin, lattice, surface, engine)) {
+        std::cerr << "a path is found without empty sites in the window\n";
+        return 1;
+    }
+    if (!search.path().empty()) return 1;
+    return 0;
+}
+
+int main() {
+    return test_distance<tumopp::Neumann<1u>>()
+         + test_distance<tumopp::Neumann<2u>>()
+         + test_distance<tumopp::Neumann<3u>>()
+         + test_distance<tumopp::Moore<2u>>()
+         + test_distance<tumopp::Moore<3u>>()
+         + test_distance<tumopp::Hexagonal<2u>>()
+         + test_distance<tumopp::Hexagonal<3u>>()
+         + test_fallback();
+}
@@ -0,0 +1,104 @@
+#include "surface.hpp"
+#include "cell_store.hpp"
+#include "lattice.hpp"
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <random>
+#include <typeinfo>
+
+//! Breadth-first search from v to the nearest empty site
+inline unsigned distance_to_empty(const tumopp::Lattice& lattice, const tumopp::Coord& coord_func, const tumopp::coord_t& v) {
+    using tumopp::operator+;
+    std::map<tumopp::coord_t, unsigned> visited{{v, 0u}};
+    std::deque<tumopp::coord_t> queue{v};
+    while (true) {
+        const auto current = queue.front();
+        queue.pop_front();
+        const unsigned next = visited[current] + 1u;
+        for (const auto& d: coord_func.directions()) {
+            const auto neighbor = current + d;
+            if (lattice.get(neighbor) == tumopp::Lattice::empty) return next;
+            if (visited.emplace(neighbor, next).second) queue.push_back(neighbor);
+        }
+    }
+}
+
+//! Compare lower bounds with exact distances; equal if exact
+inline int test_bounds(tumopp::SurfaceDistance& surface, const tumopp::Lattice& lattice,
+                       const tumopp::Coord& coord_func, const tumopp::CellStore& cells, bool exact) {
+    for (uint32_t x = 1u; x < cells.slots(); ++x) {
+        if (!cells.contains(x)) continue;
+        const auto& v = cells.coord(x);
+        const unsigned bound = surface.lower_bound(v, lattice);
+        const unsigned distance = distance_to_empty(lattice, coord_func, v);
+        if (bound > distance || (exact && bound != distance)) {
+            std::cerr << "bound " << bound << " != distance " << distance << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+template <class C> inline
+int test_surface() {
+    const C coord_func;
+    std::cout << typeid(C).name() << "\n";
+    tumopp::DenseLattice lattice(coord_func.dimensions());
+    tumopp::CellStore cells;
+    tumopp::SurfaceDistance surface(coord_func);
+    unsigned id = 0u;
+    // ball deep enough to leave a hole in the center
+    constexpr int radius = 7;
+    tumopp::coord_t v{};
+    for (v[0] = -radius; v[0] <= radius; ++v[0]) {
+        for (v[1] = -radius; v[1] <= radius; ++v[1]) {
+            for (v[2] = -radius; v[2] <= radius; ++v[2]) {
+                bool unused = false;
+                for (unsigned j = coord_func.dimensions(); j < tumopp::MAX_DIM; ++j) unused |= (v[j] != 0);
+                if (unused || coord_func.euclidean_distance(v) > radius) continue;
+                lattice.set(v, cells.emplace(v, ++id, tumopp::EventRates{}));
+            }
+        }
+    }
+    if (!surface.is_stale(cells.size())) return 1;
+    surface.build(lattice, cells);
+    std::cout << "capacity: " << surface.capacity() << "\n";
+    if (test_bounds(surface, lattice, coord_func, cells, true)) return 1;
+    // deaths in the core and births on the surface
+    const tumopp::coord_t origin{};
+    cells.release(lattice.exchange(origin, tumopp::Lattice::empty));
+    surface.vacate(origin);
+    std::mt19937 engine(42u);
+    for (int i = 0; i < 200; ++i) {
+        std::uniform_int_distribution<uint32_t> uniform(1u, static_cast<uint32_t>(cells.slots() - 1u));
+        const uint32_t x = uniform(engine);
+        if (!cells.contains(x)) continue;
+        const auto v = cells.coord(x);
+        if (i % 2 == 0) {
+            lattice.erase(v);
+            cells.release(x);
+            surface.vacate(v);
+        } else {
+            auto w = v;
+            while (lattice.get(w) != tumopp::Lattice::empty) {
+                w = tumopp::operator+(w, coord_func.directions()[static_cast<size_t>(i) % coord_func.directions().size()]);
+            }
+            lattice.set(w, cells.emplace(w, ++id, tumopp::EventRates{}));
+        }
+    }
+    if (test_bounds(surface, lattice, coord_func, cells, false)) return 1;
+    surface.build(lattice, cells);
+    return test_bounds(surface, lattice, coord_func, cells, true);
+}
+
+int main() {
+    return test_surface<tumopp::Neumann<1u>>()
+         + test_surface<tumopp::Neumann<2u>>()
+         + test_surface<tumopp::Neumann<3u>>()
+         + test_surface<tumopp::Moore<2u>>()
+         + test_surface<tumopp::Moore<3u>>()
+         + test_surface<tumopp::Hexagonal<2u>>()
+         + test_surface<tumopp::Hexagonal<3u>>();
+}
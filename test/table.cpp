@@ -0,0 +1,164 @@
+#include "table.hpp"
+#include "cell.hpp"
+
+#include <zlib.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//! Check that TsvWriter writes the same text as std::ostream
+inline int test_tsv_writer() {
+    std::mt19937_64 engine(42u);
+    std::uniform_real_distribution<double> uniform(-30.0, 30.0);
+    std::uniform_int_distribution<int> integer(std::numeric_limits<int>::min());
+    std::vector<double> values{0.0, -0.0, 1.0, 0.1, 1e-5, 1e-4, 123456789.0, 1234567890.0,
+                               1e300, 5e-324, std::numeric_limits<double>::max()};
+    for (int i = 0; i < 100000; ++i) {
+        values.push_back(std::exp(uniform(engine)) * (i % 2 ? 1.0 : -1.0));
+    }
+    for (const int precision: {1, 6, 9, 15, 17}) {
+        std::ostringstream expected;
+        std::ostringstream actual;
+        expected.precision(precision);
+        actual.precision(precision);
+        {
+            tumopp::TsvWriter tsv(actual, 100u);  // flushed many times
+            for (const double x: values) {
+                const int i = integer(engine);
+                const auto u = static_cast<unsigned>(i);
+                expected << x << "\t" << i << '\t' << u << "\n";
+                tsv << x << "\t" << i << '\t' << u << std::string("\n");
+            }
+        }
+        if (actual.str() != expected.str()) {
+            std::cerr << "TsvWriter differs from std::ostream with precision " << precision << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//! Read all groups of a file; false if std::runtime_error is thrown
+inline bool read_all(const std::string& path) {
+    try {
+        tumopp::TableReader reader(path);
+        std::ostringstream oss;
+        while (reader.next()) reader.write(oss);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return true;
+}
+
+//! Append n lower bytes of bits in little-endian
+inline void append_le(std::string* out, uint64_t bits, size_t n) {
+    for (size_t i = 0u; i < n; ++i) {
+        out->push_back(static_cast<char>((bits >> (8u * i)) & 0xffu));
+    }
+}
+
+//! Check that truncated or broken files are rejected
+inline int test_broken(const std::string& path) {
+    std::string bytes;
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(ifs), {});
+    }
+    const auto broken = path + ".broken";
+    for (size_t n = 0u; n < bytes.size(); ++n) {
+        std::ofstream(broken, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(n));
+        if (read_all(broken)) {
+            std::cerr << "truncated file of " << n << " bytes was read\n";
+            return 1;
+        }
+    }
+    // a string longer than its row group
+    std::string raw;
+    append_le(&raw, 100u, 4u);
+    raw.append("abc");
+    std::string compressed(compressBound(static_cast<uLong>(raw.size())), '\0');
+    uLongf zsize = compressed.size();
+    compress2(reinterpret_cast<Bytef*>(compressed.data()), &zsize,
+              reinterpret_cast<const Bytef*>(raw.data()), static_cast<uLong>(raw.size()),
+              Z_DEFAULT_COMPRESSION);
+    std::string file("TCF1");
+    append_le(&file, 1u, 4u);
+    append_le(&file, static_cast<uint8_t>(tumopp::Column::Type::string), 1u);
+    append_le(&file, 4u, 4u);
+    file.append("note");
+    append_le(&file, 1u, 4u);
+    append_le(&file, raw.size(), 8u);
+    append_le(&file, zsize, 8u);
+    file.append(compressed.data(), zsize);
+    append_le(&file, 0u, 4u);
+    std::ofstream(broken, std::ios::binary).write(file.data(), static_cast<std::streamsize>(file.size()));
+    const bool read = read_all(broken);
+    std::filesystem::remove(broken);
+    if (read) {
+        std::cerr << "broken string length was read\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main() {
+    if (test_tsv_writer() != 0) return 1;
+    namespace fs = std::filesystem;
+    const auto path = (fs::temp_directory_path() / "tumopp-test-table.tcf").string();
+    std::ostringstream expected;
+    expected.precision(9);
+    expected << "time\t" << tumopp::Cell::header() << "\tnote\n";
+    auto columns = tumopp::Cell::columns();
+    columns.insert(columns.begin(), tumopp::Column{"time", tumopp::Column::Type::float64});
+    columns.push_back(tumopp::Column{"note", tumopp::Column::Type::string});
+    {
+        // groups of 3 rows: the last one is partial
+        tumopp::TableWriter table(path, columns, 3u);
+        for (int i = 0; i < 10; ++i) {
+            const tumopp::Cell cell({{i, -i, 1 << 30}}, 4000000000u - i, i / 2u,
+                                    i / 3.0, -1e-300 * i, static_cast<int8_t>(i - 5));
+            const std::string note(static_cast<size_t>(i), 'a');
+            table << 0.1 * i;
+            cell.write(table) << note;
+            expected << 0.1 * i << "\t" << cell << "\t" << note << "\n";
+        }
+        try {
+            table << 1;  // int32 for time
+            std::cerr << "type mismatch was not detected\n";
+            return 1;
+        } catch (const std::logic_error&) {}
+        table.close();
+    }
+    std::ostringstream actual;
+    actual.precision(9);
+    size_t groups = 0u;
+    {
+        tumopp::TableReader reader(path);
+        if (reader.columns().size() != columns.size()) return 1;
+        reader.write_header(actual);
+        while (reader.next()) {
+            ++groups;
+            reader.write(actual);
+        }
+        std::cout << actual.str();
+    }
+    if (test_broken(path) != 0) return 1;
+    fs::remove(path);
+    if (groups != 4u) {
+        std::cerr << "groups: " << groups << "\n";
+        return 1;
+    }
+    if (actual.str() != expected.str()) {
+        std::cerr << "round trip differs:\n" << expected.str();
+        return 1;
+    }
+    return 0;
+}
@@ -1,6 +1,189 @@
 #include "tissue.hpp"
 
+#include <wtl/zlib.hpp>
+
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//! Check that a history streamed in chunks is the same as one kept in memory,
+//! and that IDs of the streamed records are dropped during the plateau
+inline int test_stream_history(const bool columnar) {
+    namespace fs = std::filesystem;
+    tumopp::EventRates rates;
+    rates.death_rate = 0.4;
+    constexpr size_t max_size = 40000u;
+    const auto path = fs::temp_directory_path()
+                      / (columnar ? "tumopp-test-history.tcf" : "tumopp-test-history.tsv.gz");
+    constexpr double plateau = 8.0;
+    std::ostringstream expected;
+    size_t num_records = 0u;
+    for (uint32_t seed = 42u; true; ++seed) {
+        tumopp::Tissue memory(1u, 3u, "moore", "const", "random", "dense", "heap",
+                              rates, tumopp::CellParams{}, seed);
+        if (!memory.grow(max_size, 1e9)) continue;  // extinct
+        memory.plateau(plateau);
+        memory.write_history(expected);
+        tumopp::Tissue streamed(1u, 3u, "moore", "const", "random", "dense", "heap",
+                                rates, tumopp::CellParams{}, seed);
+        streamed.stream_history(path.string() + ".part", columnar);
+        streamed.grow(max_size, 1e9);
+        streamed.plateau(plateau);
+        num_records = streamed.num_records();
+        streamed.finish_history(path.string());
+        break;
+    }
+    std::ostringstream actual;
+    actual.precision(std::cout.precision());
+    if (columnar) {
+        tumopp::TableReader reader(path.string());
+        reader.write_header(actual);
+        while (reader.next()) reader.write(actual);
+    } else {
+        wtl::zlib::ifstream ifs{path};
+        actual << ifs.rdbuf();
+    }
+    fs::remove(path);
+    if (actual.str() != expected.str()) {
+        std::cerr << "streamed history differs" << (columnar ? " in TCF\n" : "\n");
+        return 1;
+    }
+    const auto text = expected.str();
+    const auto lines = static_cast<size_t>(std::count(text.begin(), text.end(), '\n'));
+    if (num_records > lines / 4u) {
+        std::cerr << "IDs of streamed records are kept: " << num_records << " / " << lines << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+//! Check that --prune keeps exactly the ancestors of extant and sampled cells
+inline int test_prune() {
+    tumopp::EventRates rates;
+    rates.death_rate = 0.3;
+    constexpr size_t max_size = 5000u;
+    constexpr double interval = 2.0;
+    std::ostringstream full, full_snapshots, pruned, pruned_snapshots;
+    for (uint32_t seed = 9u; true; ++seed) {
+        tumopp::Tissue tissue(1u, 2u, "moore", "const", "random", "dense", "heap",
+                              rates, tumopp::CellParams{}, seed);
+        if (!tissue.grow(max_size, 1e9, interval)) continue;  // extinct
+        tissue.write_history(full);
+        tissue.write_snapshots(full_snapshots);
+        tumopp::Tissue prune(1u, 2u, "moore", "const", "random", "dense", "heap",
+                             rates, tumopp::CellParams{}, seed, false, false, true);
+        prune.grow(max_size, 1e9, interval);
+        prune.write_history(pruned);
+        prune.write_snapshots(pruned_snapshots);
+        break;
+    }
+    if (pruned_snapshots.str() != full_snapshots.str()) {
+        std::cerr << "--prune changes snapshots\n";
+        return 1;
+    }
+    // columns: x y z id ancestor birth death omega; extant cells have death 0
+    struct Row {std::string line; unsigned id, ancestor; bool extant;};
+    std::vector<Row> rows;
+    std::unordered_map<unsigned, unsigned> ancestor_of;
+    std::istringstream iss(full.str());
+    std::string header, line;
+    std::getline(iss, header);
+    while (std::getline(iss, line)) {
+        std::istringstream fields(line);
+        int x, y, z;
+        Row row{line, 0u, 0u, false};
+        double birth, death;
+        fields >> x >> y >> z >> row.id >> row.ancestor >> birth >> death;
+        row.extant = (death == 0.0);
+        ancestor_of[row.id] = row.ancestor;
+        rows.push_back(row);
+    }
+    std::unordered_set<unsigned> kept;
+    auto keep_lineage = [&](unsigned id) {
+        while (id != 0u && kept.insert(id).second) id = ancestor_of[id];
+    };
+    for (const auto& row: rows) {
+        if (row.extant) keep_lineage(row.ancestor);
+    }
+    std::istringstream snapshots(full_snapshots.str());
+    std::getline(snapshots, header);
+    while (std::getline(snapshots, line)) {
+        std::istringstream fields(line);
+        double time;
+        int x, y, z;
+        unsigned id, ancestor;
+        fields >> time >> x >> y >> z >> id >> ancestor;
+        keep_lineage(ancestor);
+    }
+    std::ostringstream expected;
+    expected << tumopp::Cell::header() << "\n";
+    size_t num_kept = 0u;
+    for (const auto& row: rows) {
+        if (!row.extant && !kept.count(row.id)) continue;
+        expected << row.line << "\n";
+        ++num_kept;
+    }
+    if (pruned.str() != expected.str()) {
+        std::cerr << "--prune does not keep exactly the ancestors\n";
+        return 1;
+    }
+    if (num_kept == rows.size()) {
+        std::cerr << "--prune drops nothing\n";
+        return 1;
+    }
+    return 0;
+}
+
+//! Check that surrounded cells are parked only with GAMMA_SHAPE == 1, and woken
+inline int test_park() {
+    // 1D without death: cells inside the line stay surrounded once parked
+    tumopp::CellParams params;
+    tumopp::Tissue tissue(1u, 1u, "neumann", "step", "random", "dense", "heap",
+                          tumopp::EventRates{}, params, 42u);
+    tissue.grow(60u, 1e9);
+    if (tissue.num_dormant() == 0u) {
+        std::cerr << "no cell is parked\n";
+        return 1;
+    }
+    // woken cells are rescheduled, fail to divide, and are parked again
+    const size_t inside = tissue.size() - 2u;
+    tissue.treatment(0.0, 0u);
+    if (tissue.num_dormant() != 0u) {
+        std::cerr << "treatment() leaves dormant cells\n";
+        return 1;
+    }
+    tissue.grow(tissue.size() + 200u, 1e9);
+    if (tissue.num_dormant() < inside) {
+        std::cerr << "woken cells are not rescheduled\n";
+        return 1;
+    }
+    // cells die and wake their neighbors; the count must not underflow
+    tissue.plateau(20.0);
+    if (tissue.num_dormant() > tissue.size()) {
+        std::cerr << "plateau() breaks the count of dormant cells\n";
+        return 1;
+    }
+    tissue.treatment(0.0, 0u);
+    if (tissue.num_dormant() != 0u) {
+        std::cerr << "treatment() leaves dormant cells after plateau()\n";
+        return 1;
+    }
+    // birth attempts of surrounded cells have memory otherwise
+    params.GAMMA_SHAPE = 2.0;
+    tumopp::Tissue gamma(1u, 1u, "neumann", "step", "random", "dense", "heap",
+                         tumopp::EventRates{}, params, 42u);
+    gamma.grow(60u, 1e9);
+    if (gamma.num_dormant() != 0u) {
+        std::cerr << "cells are parked with GAMMA_SHAPE != 1\n";
+        return 1;
+    }
+    return 0;
+}
 
 int main() {
     std::cout.precision(15);
@@ -9,5 +192,5 @@ int main() {
     tissue.grow(10);
     std::cout << tissue << "\n";
     tissue.write_history(std::cout);
-    return 0;
+    return test_park() + test_prune() + test_stream_history(false) + test_stream_history(true);
 }